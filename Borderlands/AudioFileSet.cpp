@@ -28,6 +28,14 @@
 //
 
 #include "AudioFileSet.h"
+#include <math.h>
+
+//decimation filter: taps either side of the centre and cutoff (cycles per
+//input sample).  81 blackman windowed taps centred on 0.21 are flat to 0.18
+//and at least 75 dB down from the new nyquist (0.25) up, so nothing folds
+//back into the octave copy
+#define OCTAVE_HALF_TAPS 40
+#define OCTAVE_CUTOFF 0.21
 
 //---------------------------------------------------------------------------
 // Destructor
@@ -50,6 +58,24 @@ AudioFileSet::~AudioFileSet()
 AudioFileSet::AudioFileSet(){
     //init fileset
     fileSet = new vector<AudioFile *>;
+    
+    //octave copies built at load
+    setNumOctaves(MIPMAP_OCTAVES);
+}
+
+//---------------------------------------------------------------------------
+// Octave copies per file (applies to files loaded afterwards)
+//---------------------------------------------------------------------------
+void AudioFileSet::setNumOctaves(unsigned int theNumOctaves)
+{
+    if (theNumOctaves > MAX_OCTAVES)
+        theNumOctaves = MAX_OCTAVES;
+    numOctaves = theNumOctaves;
+}
+
+unsigned int AudioFileSet::getNumOctaves()
+{
+    return numOctaves;
 }
 
 //---------------------------------------------------------------------------
@@ -150,7 +176,7 @@ int AudioFileSet::loadFileSet(string localPath)
             //length corresponds to the number of frames * number of channels  (1 frame contains L, R pair or chans 1,2,3...)
             unsigned long fullSize = sfinfo.frames * sfinfo.channels;
             
-            fileSet->push_back(new AudioFile(theFileName,myPath,sfinfo.channels,sfinfo.frames,sfinfo.samplerate,new double[fullSize]));
+            fileSet->push_back(new AudioFile(theFileName,myPath,sfinfo.channels,sfinfo.frames,sfinfo.samplerate,new SAMPLE[fullSize]));
 
                                
             //accumulate the samples
@@ -165,7 +191,7 @@ int AudioFileSet::loadFileSet(string localPath)
                 {
                     if (counter < fullSize){
                         //if ((i % sfinfo.channels) == 0){
-                        fileSet->at(fileCounter)->wave[counter] = stereoBuff[i]*globalAtten;
+                        fileSet->at(fileCounter)->wave[counter] = (SAMPLE) (stereoBuff[i]*globalAtten);
                         counter++;
                     }
                     
@@ -178,6 +204,12 @@ int AudioFileSet::loadFileSet(string localPath)
                 
             } while(!empty);
             cout << counter << endl;
+            
+            //band limited copies for high pitch grains
+            if (numOctaves > 0){
+                buildOctaves(fileSet->at(fileCounter), numOctaves);
+            }
+            
             //increment the file counter
             fileCounter++;
             
@@ -195,7 +227,61 @@ int AudioFileSet::loadFileSet(string localPath)
 }
 
 
-
-
-
-
+//---------------------------------------------------------------------------
+//  Build decimated copies of a file, one octave at a time.  Each octave is
+//  low passed (windowed sinc) and every other frame kept, so frame i of
+//  octave k lines up with frame 2i of octave k-1.  Frames past the ends
+//  count as silence.  Stops early once an octave gets too short to play.
+//---------------------------------------------------------------------------
+void AudioFileSet::buildOctaves(AudioFile * theFile, unsigned int theNumOctaves)
+{
+    if (theNumOctaves > MAX_OCTAVES)
+        theNumOctaves = MAX_OCTAVES;
+    
+    //filter taps (blackman windowed sinc, unity gain at DC)
+    double h[2*OCTAVE_HALF_TAPS + 1];
+    double sum = 0.0;
+    for (int j = -OCTAVE_HALF_TAPS; j <= OCTAVE_HALF_TAPS; j++){
+        double x = 2.0 * M_PI * OCTAVE_CUTOFF * j;
+        double sinc = (j == 0) ? 1.0 : sin(x) / x;
+        double w = 0.42 + 0.5 * cos(M_PI * j / (OCTAVE_HALF_TAPS + 1)) + 0.08 * cos(2.0 * M_PI * j / (OCTAVE_HALF_TAPS + 1));
+        h[j + OCTAVE_HALF_TAPS] = sinc * w;
+        sum += sinc * w;
+    }
+    for (int j = 0; j < 2*OCTAVE_HALF_TAPS + 1; j++)
+        h[j] /= sum;
+    
+    const unsigned int chans = theFile->channels;
+    
+    //drop any copies from an earlier build
+    for (unsigned int k = 1; k <= theFile->numOctaves; k++)
+        delete [] theFile->octaveWave[k];
+    theFile->numOctaves = 0;
+    
+    for (unsigned int k = 1; k <= theNumOctaves; k++){
+        const SAMPLE * src = theFile->octaveWave[k-1];
+        const long srcFrames = (long) theFile->octaveFrames[k-1];
+        if (srcFrames < 2*OCTAVE_HALF_TAPS)
+            break;
+        
+        const long dstFrames = (srcFrames + 1)/2;
+        SAMPLE * dst = new SAMPLE[dstFrames * chans];
+        
+        for (long i = 0; i < dstFrames; i++){
+            const long centre = 2*i;
+            //taps that land inside the file
+            long j0 = (centre - OCTAVE_HALF_TAPS < 0) ? -centre : -OCTAVE_HALF_TAPS;
+            long j1 = (centre + OCTAVE_HALF_TAPS >= srcFrames) ? srcFrames - 1 - centre : OCTAVE_HALF_TAPS;
+            for (unsigned int c = 0; c < chans; c++){
+                double acc = 0.0;
+                for (long j = j0; j <= j1; j++)
+                    acc += h[j + OCTAVE_HALF_TAPS] * src[(centre + j)*chans + c];
+                dst[i*chans + c] = (SAMPLE) acc;
+            }
+        }
+        
+        theFile->octaveWave[k] = dst;
+        theFile->octaveFrames[k] = dstFrames;
+        theFile->numOctaves = k;
+    }
+}
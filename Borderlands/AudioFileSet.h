@@ -54,10 +54,18 @@ struct AudioFile{
         this->channels = numChan;
         this->sampleRate = srate;
         this->wave = theWave;
+        
+        //octave 0 is the file itself, decimated copies are added by AudioFileSet
+        this->numOctaves = 0;
+        this->octaveWave[0] = theWave;
+        this->octaveFrames[0] = numFrames;
 
     }
     //destructor
     ~AudioFile(){
+        for (unsigned int k = 1; k <= numOctaves; k++){
+            delete [] octaveWave[k];
+        }
         if (wave != NULL){
             delete [] wave;
         }
@@ -70,6 +78,12 @@ struct AudioFile{
     unsigned long lengthSamps;
     unsigned int channels;
     unsigned int sampleRate;
+    
+    //band limited copies: octave k holds every 2^k th frame (low passed below
+    //its nyquist first), so frame f of the file is frame f/2^k of octave k
+    unsigned int numOctaves;
+    SAMPLE * octaveWave[MAX_OCTAVES + 1];
+    unsigned long octaveFrames[MAX_OCTAVES + 1];
 };
 
 
@@ -86,6 +100,13 @@ public:
     //read in all audio files contained in 
     int loadFileSet(string path);
     
+    //number of octave copies built for each file at load (0 = none)
+    void setNumOctaves(unsigned int numOctaves);
+    unsigned int getNumOctaves();
+    
+    //build numOctaves decimated copies of a file
+    static void buildOctaves(AudioFile * theFile, unsigned int numOctaves);
+    
     //return the audio vector- note, the intension is for the files to be
     //read only.  if write access is needed in the future - thread safety will
     //need to be considered
@@ -94,6 +115,9 @@ public:
     
 private:    
     vector<AudioFile *> * fileSet;
+    
+    //octave copies to build per file
+    unsigned int numOctaves;
 
 };
 
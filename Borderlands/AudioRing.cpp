@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  AudioRing.cpp
+//  Borderlands
+//
+
+#include "AudioRing.h"
+#include "GrainKernels.h"
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+AudioRing::AudioRing(unsigned int theFrames)
+{
+    size = 1;
+    while (size < theFrames)
+        size *= 2;
+    mask = size - 1;
+    data = (SAMPLE *) grainAlloc(sizeof(SAMPLE) * size * MY_CHANNELS);
+    memset(data, 0, sizeof(SAMPLE) * size * MY_CHANNELS);
+    writePos = 0;
+    readPos = 0;
+}
+
+AudioRing::~AudioRing()
+{
+    grainFree(data);
+}
+
+
+//-----------------------------------------------------------------------------
+// Fill state (either side may ask).  positions are read with acquire
+// ordering so the frames - or free space - they cover are visible
+//-----------------------------------------------------------------------------
+unsigned int AudioRing::readable()
+{
+    const unsigned long r = readPos.load(std::memory_order_acquire);
+    return (unsigned int) (writePos.load(std::memory_order_acquire) - r);
+}
+
+unsigned int AudioRing::writable()
+{
+    return size - readable();
+}
+
+
+//-----------------------------------------------------------------------------
+// Copy in / out (in at most two pieces around the end of the storage)
+//-----------------------------------------------------------------------------
+void AudioRing::write(const SAMPLE * buff, unsigned int numFrames)
+{
+    const unsigned long pos = writePos.load(std::memory_order_relaxed);
+    const unsigned int start = (unsigned int) (pos & mask);
+    unsigned int first = size - start;
+    if (first > numFrames)
+        first = numFrames;
+    memcpy(data + start*MY_CHANNELS, buff, sizeof(SAMPLE) * first * MY_CHANNELS);
+    memcpy(data, buff + first*MY_CHANNELS, sizeof(SAMPLE) * (numFrames - first) * MY_CHANNELS);
+    writePos.store(pos + numFrames, std::memory_order_release);
+}
+
+unsigned int AudioRing::read(SAMPLE * buff, unsigned int numFrames)
+{
+    const unsigned int avail = readable();
+    if (numFrames > avail)
+        numFrames = avail;
+    const unsigned long pos = readPos.load(std::memory_order_relaxed);
+    const unsigned int start = (unsigned int) (pos & mask);
+    unsigned int first = size - start;
+    if (first > numFrames)
+        first = numFrames;
+    memcpy(buff, data + start*MY_CHANNELS, sizeof(SAMPLE) * first * MY_CHANNELS);
+    memcpy(buff + first*MY_CHANNELS, data, sizeof(SAMPLE) * (numFrames - first) * MY_CHANNELS);
+    readPos.store(pos + numFrames, std::memory_order_release);
+    return numFrames;
+}
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  AudioRing.h
+//  Borderlands
+//
+//  Lock-free ring of interleaved frames between one writer (the render
+//  thread) and one reader (the audio callback).  Each side only moves its
+//  own position, so neither ever waits for the other.
+//
+
+
+#ifndef AUDIORING_H
+#define AUDIORING_H
+
+#include "theglobals.h"
+#include <atomic>
+
+
+class AudioRing
+{
+public:
+    //destructor
+    virtual ~AudioRing();
+
+    //constructor (room for at least theFrames frames of MY_CHANNELS)
+    AudioRing(unsigned int theFrames);
+
+    //frames waiting to be read / room left to write
+    unsigned int readable();
+    unsigned int writable();
+
+    //append numFrames frames (at most writable()) - writer thread only
+    void write(const SAMPLE * buff, unsigned int numFrames);
+
+    //take up to numFrames frames, returns how many were there - reader only
+    unsigned int read(SAMPLE * buff, unsigned int numFrames);
+
+private:
+    //storage (size frames, a power of two)
+    SAMPLE * data;
+    unsigned int size, mask;
+
+    //frames written / read so far (only the low bits index the ring)
+    std::atomic<unsigned long> writePos;
+    std::atomic<unsigned long> readPos;
+};
+
+
+#endif
@@ -60,6 +60,12 @@
 
 //graphics and audio related
 #include "GrainCluster.h"
+#include "Limiter.h"
+#include "AudioRing.h"
+#include "Governor.h"
+#include "CloudBounce.h"
+#include <chrono>
+#include <limits.h>
 
 
 using namespace std;
@@ -96,8 +102,28 @@ unsigned int g_buffSize = 1024;
 vector <AudioFile *> * mySounds = NULL;
 //audio file visualization objects
 vector <SoundRect *> * soundViews = NULL;
+//sounds (and rectangles) the render threads may read.  a bounce is appended
+//to both vectors first, then published here (release)
+std::atomic<unsigned int> numSharedSounds(0);
+//spatial index of the rectangles (hit tests for grains and the mouse)
+RectGrid * rectGrid = NULL;
 //grain cloud audio objects
 vector<GrainCluster *> * grainCloud = NULL;
+//voice pool shared by all clouds (MAX_POLYPHONY voices)
+GrainVoiceBank * voicePool = NULL;
+//master output stage
+Limiter * masterLimiter = NULL;
+//load governor (degrades rendering under overload)
+Governor * loadGovernor = NULL;
+//cloud being bounced in the background, and loops of frozen clouds
+CloudBounce * pendingBounce = NULL;
+vector<LoopPlayer *> * loopPlayers = NULL;
+unsigned int numBounces = 0;
+//deleted clouds: the ui thread fills a slot (RETIRE_PENDING), the render
+//thread stops the cloud's grains (RETIRE_RELEASED), the ui thread frees it
+enum{RETIRE_EMPTY,RETIRE_PENDING,RETIRE_RELEASED};
+GrainCluster * retiredClouds[MAX_RETIRED_CLOUDS];
+std::atomic<int> retiredState[MAX_RETIRED_CLOUDS];
 //grain cloud visualization objects
 vector<GrainClusterVis *> * grainCloudVis;
 //cloud counter
@@ -107,6 +133,21 @@ unsigned int numClouds = 0;
 //global time is incremented in audio callback
 const double samp_time_sec = (double) 1.0 / (double)MY_SRATE;
 
+//the engine renders fixed blocks of ENGINE_BLOCK frames whatever size of
+//buffer the device asks for - the callback hands frames out of the current
+//block and renders the next one when it runs out
+SAMPLE engineBlock[ENGINE_BLOCK*MY_CHANNELS];
+unsigned int engineBlockPos = ENGINE_BLOCK;
+
+//look-ahead rendering (RENDER_AHEAD_BLOCKS > 0): a render thread keeps
+//renderAheadFrames frames queued in the ring and the callback only copies
+AudioRing * renderRing = NULL;
+Thread * renderThread = NULL;
+std::atomic<bool> renderRunning(false);
+unsigned int renderAheadFrames = 0;
+//callbacks that found the ring short (the gap is filled with silence)
+unsigned long renderUnderruns = 0;
+
 
 //Initial camera movement vars
 //my position
@@ -135,7 +176,7 @@ bool menuFlag = true;
 int selectionIndex = 0;
 
 //cloud parameter changing
-enum{NUMGRAINS,DURATION,WINDOW, MOTIONX, MOTIONY,MOTIONXY,DIRECTION,OVERLAP, PITCH, ANIMATE,P_LFO_FREQ,P_LFO_AMT,SPATIALIZE,VOLUME};
+enum{NUMGRAINS,DURATION,WINDOW, MOTIONX, MOTIONY,MOTIONXY,DIRECTION,OVERLAP, PITCH, ANIMATE,P_LFO_FREQ,P_LFO_AMT,SPATIALIZE,VOLUME,INTERP,PRIORITY,DENSITY};
 //flag indicating parameter change
 bool paramChanged = false;
 unsigned int currentParam = NUMGRAINS;
@@ -175,7 +216,13 @@ void printUsage();
 void printParam();
 void drawAxis();
 int audioCallback( void * outputBuffer, void * inputBuffer, unsigned int numFrames, double streamTime,RtAudioStreamStatus status, void * userData);
+void renderEngineBlock();
 void cleaningFunction();
+void freezeCloud(int idx, double seconds);
+void finishBounce();
+bool retireCloud(int idx);
+void releaseRetiredClouds();
+void freeRetiredClouds();
 
 
 
@@ -191,14 +238,44 @@ void cleaningFunction(){
     } catch (RtError &err) {
         err.printMessage();
     }
+    //abandon a bounce in progress
+    if (pendingBounce != NULL){
+        delete pendingBounce;
+        pendingBounce = NULL;
+    }
+    //stop the render thread before anything it touches goes away
+    if (renderThread != NULL){
+        renderRunning = false;
+        renderThread->wait();
+        delete renderThread;
+        renderThread = NULL;
+    }
+    if (renderRing != NULL){
+        if (renderUnderruns > 0)
+            cout << "render thread fell behind " << renderUnderruns << " times" << endl;
+        delete renderRing;
+    }
     if (mySounds != NULL)
         delete mySounds;
     if (theAudio !=NULL)
         delete theAudio;
+    if (masterLimiter != NULL)
+        delete masterLimiter;
+    if (loadGovernor != NULL)
+        delete loadGovernor;
     
     if (grainCloud!=NULL){
         delete grainCloud;
     }    
+    //clouds deleted since the render thread last ran
+    for (int i = 0; i < MAX_RETIRED_CLOUDS; i++){
+        if (retiredState[i] != RETIRE_EMPTY){
+            delete retiredClouds[i];
+            retiredState[i] = RETIRE_EMPTY;
+        }
+    }
+    if (voicePool != NULL)
+        delete voicePool;
     
     if (grainCloudVis!=NULL){
         delete grainCloudVis;
@@ -206,6 +283,8 @@ void cleaningFunction(){
     if (soundViews != NULL){
         delete soundViews;
     }
+    if (rectGrid != NULL)
+        delete rectGrid;
     if (selectionIndices != NULL){
         delete selectionIndices;
     }
@@ -218,7 +297,191 @@ void cleaningFunction(){
 //   Audio Callback
 //================================================================================
 
-//audio callback
+//set the pool and clouds up for a governor stage.  thinning applies to the
+//clouds below the highest priority (all of them if they are level)
+void applyGovernor(int stage)
+{
+    voicePool->setInterpolationLimit((stage >= GOVERN_INTERP) ? INTERP_LINEAR : NUM_INTERP - 1);
+    voicePool->setCloudVoiceCap((stage >= GOVERN_VOICES) ? GOVERN_CLOUD_VOICES : 0);
+    
+    int topPriority = INT_MIN;
+    int lowPriority = INT_MAX;
+    for (int i = 0; i < grainCloud->size(); i++){
+        int p = grainCloud->at(i)->getPriority();
+        if (p > topPriority)
+            topPriority = p;
+        if (p < lowPriority)
+            lowPriority = p;
+    }
+    for (int i = 0; i < grainCloud->size(); i++){
+        bool low = (grainCloud->at(i)->getPriority() < topPriority) || (lowPriority == topPriority);
+        grainCloud->at(i)->setThinning(((stage >= GOVERN_THIN) && low) ? GOVERN_THIN_FACTOR : 1);
+    }
+}
+
+
+//freeze a cloud: bounce it in the background (finishBounce swaps it for the
+//loop).  a frozen cloud is thawed instead
+void freezeCloud(int idx, double seconds)
+{
+    GrainCluster * theCloud = grainCloud->at(idx);
+    for (int i = 0; i < loopPlayers->size(); i++){
+        LoopPlayer * theLoop = loopPlayers->at(i);
+        if ((theLoop->getCloudId() == theCloud->getId()) && theLoop->getActiveState()){
+            theLoop->setActive(false);
+            //the cloud may still be fading out
+            theCloud->cancelFade();
+            if (!theCloud->getActiveState())
+                theCloud->toggleActive();
+            return;
+        }
+    }
+    
+    if (pendingBounce != NULL){
+        cout << "already bouncing a cloud" << endl;
+        return;
+    }
+    if (numBounces >= MAX_BOUNCES){
+        cout << "no room for more bounces (MAX_BOUNCES = " << MAX_BOUNCES << ")" << endl;
+        return;
+    }
+    pendingBounce = new CloudBounce(theCloud, grainCloudVis->at(idx), mySounds, soundViews, seconds, numBounces + 1);
+    if (!pendingBounce->start()){
+        delete pendingBounce;
+        pendingBounce = NULL;
+    }
+}
+
+
+//add a finished bounce to the landscape and loop it in place of its cloud.
+//the sound goes in before its rectangle - clouds size their position
+//buffers by the sound count and fill them from the rectangles
+void finishBounce()
+{
+    AudioFile * theFile = pendingBounce->takeFile();
+    unsigned int theCloudId = pendingBounce->getCloudId();
+    double theStartTime = pendingBounce->getStartTime();
+    delete pendingBounce;
+    pendingBounce = NULL;
+    if (theFile == NULL)
+        return;
+    numBounces++;
+    
+    mySounds->push_back(theFile);
+    SoundRect * theRect = new SoundRect();
+    theRect->associateSound(theFile->wave,theFile->frames,theFile->channels);
+    soundViews->push_back(theRect);
+    numSharedSounds.store((unsigned int) soundViews->size(), std::memory_order_release);
+    theRect->setGrid(rectGrid, soundViews->size() - 1);
+    cout << "bounced " << theFile->name << " (" << (double) theFile->frames / MY_SRATE << " s)" << endl;
+    
+    //the cloud may have been deleted meanwhile
+    for (int i = 0; i < grainCloud->size(); i++){
+        GrainCluster * theCloud = grainCloud->at(i);
+        if (theCloud->getId() == theCloudId){
+            //the loop fades in as the cloud fades out (the cloud then
+            //switches itself off)
+            loopPlayers->push_back(new LoopPlayer(theFile, theCloudId, theCloud->getActiveState() ? theCloud : NULL, theStartTime));
+            break;
+        }
+    }
+}
+
+
+//take a deleted cloud out of the lists.  it is freed (freeRetiredClouds)
+//once the render thread has stopped its grains and let go of it - false if
+//too many deletions are still waiting for that
+bool retireCloud(int idx)
+{
+    for (int i = 0; i < MAX_RETIRED_CLOUDS; i++){
+        if (retiredState[i].load(std::memory_order_acquire) == RETIRE_EMPTY){
+            retiredClouds[i] = grainCloud->at(idx);
+            //silence its loop if it was frozen
+            for (unsigned int j = 0; j < loopPlayers->size(); j++){
+                if (loopPlayers->at(j)->getCloudId() == retiredClouds[i]->getId())
+                    loopPlayers->at(j)->setActive(false);
+            }
+            grainCloud->erase(grainCloud->begin() + idx);
+            grainCloudVis->erase(grainCloudVis->begin() + idx);
+            retiredState[i].store(RETIRE_PENDING, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+//render thread, before a block: stop the grains of deleted clouds.  blocks
+//from here on no longer see them in grainCloud
+void releaseRetiredClouds()
+{
+    for (int i = 0; i < MAX_RETIRED_CLOUDS; i++){
+        if (retiredState[i].load(std::memory_order_acquire) == RETIRE_PENDING){
+            retiredClouds[i]->releaseVoices();
+            retiredState[i].store(RETIRE_RELEASED, std::memory_order_release);
+        }
+    }
+}
+
+//ui thread: free the deleted clouds the render thread is done with
+void freeRetiredClouds()
+{
+    for (int i = 0; i < MAX_RETIRED_CLOUDS; i++){
+        if (retiredState[i].load(std::memory_order_acquire) == RETIRE_RELEASED){
+            delete retiredClouds[i];
+            retiredClouds[i] = NULL;
+            retiredState[i].store(RETIRE_EMPTY, std::memory_order_release);
+        }
+    }
+}
+
+
+//render one engine block.  cloud parameters, LFOs and the clock all move
+//on block boundaries, so timing does not depend on the device buffer size
+void renderEngineBlock()
+{
+    std::chrono::steady_clock::time_point blockStart = std::chrono::steady_clock::now();
+    
+    memset(engineBlock, 0, sizeof(SAMPLE)*ENGINE_BLOCK*MY_CHANNELS );
+    releaseRetiredClouds();
+    if (menuFlag == false){
+        //loops first - a new loop starts its cloud's fade in this block
+        for(int i = 0; i < loopPlayers->size(); i++){
+            loopPlayers->at(i)->nextBuffer(engineBlock, ENGINE_BLOCK);
+        }
+        for(int i = 0; i < grainCloud->size(); i++){
+            grainCloud->at(i)->nextBuffer(engineBlock, ENGINE_BLOCK);
+        }
+    }
+    //keep the summed clouds under the ceiling
+    masterLimiter->process(engineBlock, ENGINE_BLOCK);
+    GTime::instance().sec += ENGINE_BLOCK*samp_time_sec;
+    
+    //time this block took against the time it lasts
+    if (loadGovernor != NULL){
+        std::chrono::duration<double> took = std::chrono::steady_clock::now() - blockStart;
+        applyGovernor(loadGovernor->update(took.count()));
+    }
+    // cout << GTime::instance().sec<<endl;
+    engineBlockPos = 0;
+}
+
+
+//render thread - keeps the ring topped up to renderAheadFrames, in engine
+//blocks, and naps while it is full
+THREAD_RETURN THREAD_TYPE renderLoop(void * ptr)
+{
+    while (renderRunning){
+        while (renderRunning && (renderRing->readable() + ENGINE_BLOCK <= renderAheadFrames)){
+            renderEngineBlock();
+            renderRing->write(engineBlock, ENGINE_BLOCK);
+        }
+        Stk::sleep(1);
+    }
+    return 0;
+}
+
+
+//audio callback - assembles the device buffer from engine blocks
 int audioCallback( void * outputBuffer, void * inputBuffer, unsigned int numFrames, double streamTime,
                   RtAudioStreamStatus status, void * userData)
 {
@@ -226,14 +489,27 @@ int audioCallback( void * outputBuffer, void * inputBuffer, unsigned int numFram
     SAMPLE * out = (SAMPLE *)outputBuffer;
     SAMPLE * in = (SAMPLE *)inputBuffer;
     
-    memset(out, 0, sizeof(SAMPLE)*numFrames*MY_CHANNELS );
-    if (menuFlag == false){
-        for(int i = 0; i < grainCloud->size(); i++){
-            grainCloud->at(i)->nextBuffer(out, numFrames);
+    //look-ahead mode - the audio is already rendered
+    if (renderRing != NULL){
+        unsigned int got = renderRing->read(out, numFrames);
+        if (got < numFrames){
+            memset(out + got*MY_CHANNELS, 0, sizeof(SAMPLE)*(numFrames - got)*MY_CHANNELS);
+            renderUnderruns++;
         }
+        return 0;
+    }
+    
+    unsigned int done = 0;
+    while (done < numFrames){
+        if (engineBlockPos == ENGINE_BLOCK)
+            renderEngineBlock();
+        unsigned int n = ENGINE_BLOCK - engineBlockPos;
+        if (n > numFrames - done)
+            n = numFrames - done;
+        memcpy(out + done*MY_CHANNELS, engineBlock + engineBlockPos*MY_CHANNELS, sizeof(SAMPLE)*n*MY_CHANNELS);
+        engineBlockPos += n;
+        done += n;
     }
-    GTime::instance().sec += numFrames*samp_time_sec;
-    // cout << GTime::instance().sec<<endl;
     return 0;
 }
 
@@ -435,6 +711,14 @@ void displayFunc()
 //print current param if editing
         if ( (selectedCloud >= 0) || (selectedRect >= 0) )
             printParam();
+        
+        //bounce progress
+        if (pendingBounce != NULL){
+            ostringstream progress;
+            progress << "Bouncing cloud: " << (int) (100.0f * pendingBounce->getProgress()) << "%";
+            glColor4f(0.8,0.8,0.8,0.8);
+            draw_string(20.0,(GLfloat) (screenHeight - 30.0),0.0,progress.str().c_str(),100.0f);
+        }
     }else{
         printUsage();
     }
@@ -479,6 +763,11 @@ void reshape(int w, int h)
 //-----------------------------------------------------------------------------
 
 void idleFunc(){
+    //pick up a finished bounce
+    if ((pendingBounce != NULL) && pendingBounce->isDone())
+        finishBounce();
+    //free deleted clouds
+    freeRetiredClouds();
     // render the scene
     glutPostRedisplay( );
 }
@@ -580,6 +869,10 @@ void printParam(){
             case NUMGRAINS:
                 myValue = "Voices: ";
                 sinput << theCloud->getNumVoices();            
+                //share of voice frames skipped because the grain had nothing left to play
+                if (theCloud->getVoiceFrames() > 0){
+                    sinput << " (" << (int) (100.0 * theCloud->getSkippedVoiceFrames() / theCloud->getVoiceFrames()) << "% skipped)";
+                }
                 myValue = myValue+ sinput.str();
                 draw_string((GLfloat)mouseX,(GLfloat) (screenHeight-mouseY),0.0,myValue.c_str(),100.0f);
                 break;
@@ -611,6 +904,18 @@ void printParam(){
                     case SINC:
                         myValue = "Window: SINC";
                         break;
+                    case GAUSSIAN:
+                        myValue = "Window: GAUSSIAN";
+                        break;
+                    case TUKEY:
+                        myValue = "Window: TUKEY";
+                        break;
+                    case BLACKMAN_HARRIS:
+                        myValue = "Window: BLACKMAN_HARRIS";
+                        break;
+                    case KAISER:
+                        myValue = "Window: KAISER";
+                        break;
                     case RANDOM_WIN:
                         myValue = "Window: RANDOM_WIN";
                         break;
@@ -619,6 +924,55 @@ void printParam(){
                         break;
                 }
                 
+                draw_string((GLfloat)mouseX,(GLfloat) (screenHeight-mouseY),0.0,myValue.c_str(),100.0f);
+                break;
+            case INTERP:
+                switch (theCloud->getInterpolation()) {
+                    case INTERP_LINEAR:
+                        myValue = "Interpolation: LINEAR";
+                        break;
+                    case INTERP_CUBIC:
+                        myValue = "Interpolation: CUBIC";
+                        break;
+                    case INTERP_SINC8:
+                        myValue = "Interpolation: SINC8";
+                        break;
+                    case INTERP_SINC16:
+                        myValue = "Interpolation: SINC16";
+                        break;
+                    default:
+                        myValue = "";
+                        break;
+                }
+                
+                draw_string((GLfloat)mouseX,(GLfloat) (screenHeight-mouseY),0.0,myValue.c_str(),100.0f);
+                break;
+            case DENSITY:
+                switch (theCloud->getDensityMode()) {
+                    case DENSITY_JITTER:
+                        myValue = "Density (grains/s, JITTER): ";
+                        break;
+                    case DENSITY_POISSON:
+                        myValue = "Density (grains/s, POISSON): ";
+                        break;
+                    default:
+                        myValue = "Density: OVERLAP";
+                        break;
+                }
+                if (theCloud->getDensityMode() != DENSITY_OVERLAP){
+                    if (paramString == ""){
+                        sinput << theCloud->getGrainRate();
+                        myValue = myValue + sinput.str();
+                    }else{
+                        myValue = myValue + paramString;
+                    }
+                }
+                draw_string((GLfloat)mouseX,(GLfloat) (screenHeight-mouseY),0.0,myValue.c_str(),100.0f);
+                break;
+            case PRIORITY:
+                myValue = "Priority: ";
+                sinput << theCloud->getPriority();
+                myValue = myValue + sinput.str();
                 draw_string((GLfloat)mouseX,(GLfloat) (screenHeight-mouseY),0.0,myValue.c_str(),100.0f);
                 break;
             case MOTIONX:
@@ -899,15 +1253,35 @@ void keyboardFunc( unsigned char key, int x, int y )
             break;
         case'7':
             paramString.push_back('7');
+            if (currentParam == WINDOW){
+                if (selectedCloud >=0){
+                    grainCloud->at(selectedCloud)->setWindowType(6);
+                }
+            }
             break;
         case'8':
             paramString.push_back('8');
+            if (currentParam == WINDOW){
+                if (selectedCloud >=0){
+                    grainCloud->at(selectedCloud)->setWindowType(7);
+                }
+            }
             break;
         case'9':
             paramString.push_back('9');
+            if (currentParam == WINDOW){
+                if (selectedCloud >=0){
+                    grainCloud->at(selectedCloud)->setWindowType(8);
+                }
+            }
             break;
         case '0':
             paramString.push_back('0');
+            if (currentParam == WINDOW){
+                if (selectedCloud >=0){
+                    grainCloud->at(selectedCloud)->setWindowType(RANDOM_WIN);
+                }
+            }
             break;
         case '.':
             paramString.push_back('.');            
@@ -937,6 +1311,11 @@ void keyboardFunc( unsigned char key, int x, int y )
                             grainCloud->at(selectedCloud)->setPitch(value);
                         }
                         break;
+                    case DENSITY:
+                        if (selectedCloud >=0){
+                            grainCloud->at(selectedCloud)->setGrainRate(value);
+                        }
+                        break;
                     case P_LFO_FREQ:
                         if (selectedCloud >=0){
                             grainCloud->at(selectedCloud)->setPitchLFOFreq(value);
@@ -1019,6 +1398,37 @@ void keyboardFunc( unsigned char key, int x, int y )
                 }
             }
             break;
+        case 'E'://grain rate (asynchronous density modes)
+        case 'e':
+            paramString = "";
+            if (currentParam != DENSITY){
+                currentParam = DENSITY;
+            }else{
+                if (modkey == GLUT_ACTIVE_SHIFT){
+                    if (selectedCloud >=0){
+                        float theRate = grainCloud->at(selectedCloud)->getGrainRate();
+                        grainCloud->at(selectedCloud)->setGrainRate(theRate * 0.9f);
+                    }
+                }else{
+                    if (selectedCloud >=0){
+                        float theRate = grainCloud->at(selectedCloud)->getGrainRate();
+                        grainCloud->at(selectedCloud)->setGrainRate(theRate * 1.1f);
+                    }
+                }
+            }
+            break;
+        case 'J'://density mode
+        case 'j':
+            paramString = "";
+            if (currentParam != DENSITY){
+                currentParam = DENSITY;
+            }else{
+                if (selectedCloud >=0){
+                    int theMode = grainCloud->at(selectedCloud)->getDensityMode();
+                    grainCloud->at(selectedCloud)->setDensityMode(theMode + 1);
+                }
+            }
+            break;
         case 'R':
         case 'r':
             if (selectedCloud >=0){
@@ -1141,9 +1551,10 @@ void keyboardFunc( unsigned char key, int x, int y )
                     }
                     selectedCloud = idx;
                     //create audio
-                    grainCloud->push_back(new GrainCluster(mySounds,numVoices));
+                    grainCloud->push_back(new GrainCluster(mySounds,numVoices,voicePool));
                     //create visualization
-                    grainCloudVis->push_back(new GrainClusterVis(mouseX,mouseY,numVoices,soundViews));
+                    grainCloudVis->push_back(new GrainClusterVis(mouseX,mouseY,numVoices,soundViews,rectGrid));
+                    grainCloudVis->back()->setSoundCount(&numSharedSounds);
                     //select new cloud
                     grainCloudVis->at(idx)->setSelectState(true);
                     //register visualization with audio
@@ -1198,8 +1609,43 @@ void keyboardFunc( unsigned char key, int x, int y )
                 }
             }
             break;    
-        case 'I':
+        case 'I'://interpolation quality for grain
         case 'i':
+            paramString = "";
+            if (currentParam != INTERP){
+                currentParam = INTERP;
+            }else{
+                if (modkey == GLUT_ACTIVE_SHIFT){
+                    if (selectedCloud >=0){
+                        int theInterp = grainCloud->at(selectedCloud)->getInterpolation();
+                        grainCloud->at(selectedCloud)->setInterpolation(theInterp - 1);
+                    }
+                }else{
+                    if (selectedCloud >=0){
+                        int theInterp = grainCloud->at(selectedCloud)->getInterpolation();
+                        grainCloud->at(selectedCloud)->setInterpolation(theInterp + 1);
+                    }
+                }
+            }
+            break;
+        case 'N'://voice stealing priority for cloud
+        case 'n':
+            paramString = "";
+            if (currentParam != PRIORITY){
+                currentParam = PRIORITY;
+            }else{
+                if (modkey == GLUT_ACTIVE_SHIFT){
+                    if (selectedCloud >=0){
+                        int thePriority = grainCloud->at(selectedCloud)->getPriority();
+                        grainCloud->at(selectedCloud)->setPriority(thePriority - 1);
+                    }
+                }else{
+                    if (selectedCloud >=0){
+                        int thePriority = grainCloud->at(selectedCloud)->getPriority();
+                        grainCloud->at(selectedCloud)->setPriority(thePriority + 1);
+                    }
+                }
+            }
             break;
             
             
@@ -1291,10 +1737,12 @@ void keyboardFunc( unsigned char key, int x, int y )
         case 127://delete selected
             if (paramString == ""){
                 if (selectedCloud >=0){
-                    grainCloud->erase(grainCloud->begin() + selectedCloud);
-                    grainCloudVis->erase(grainCloudVis->begin() + selectedCloud);
-                    selectedCloud = -1;
-                    numClouds-=1;
+                    if (retireCloud(selectedCloud)){
+                        selectedCloud = -1;
+                        numClouds-=1;
+                    }else{
+                        cout << "still deleting clouds - try again" << endl;
+                    }
                 }
             }else{
                 if (paramString.size () > 0)  paramString.resize (paramString.size () - 1);
@@ -1308,6 +1756,16 @@ void keyboardFunc( unsigned char key, int x, int y )
                 grainCloud->at(selectedCloud)->toggleActive();
             }
             break;
+        case 'C'://freeze (bounce) / unfreeze cloud
+        case 'c':
+            if (selectedCloud >=0){
+                double seconds = BOUNCE_DEFAULT_SECS;
+                if (paramString != "")
+                    seconds = atof(paramString.c_str());
+                freezeCloud(selectedCloud, seconds);
+            }
+            paramString = "";
+            break;
         case '=':
         case '+':
             
@@ -1377,7 +1835,9 @@ void mouseFunc(int button, int state, int x, int y){
                 
                 lastDragX = veryHighNumber;
                 lastDragY = veryHighNumber;
-                //first check grain clouds to see if we have selection
+                //first check grain clouds to see if we have selection.  clouds
+                //are few, are created by hand and change index when one is
+                //deleted, so they are scanned rather than kept in rectGrid
                 for (int i = 0; i < grainCloudVis->size(); i++){
                     if (grainCloudVis->at(i)->select(mouseX, mouseY) == true){
                         grainCloudVis->at(i)->setSelectState(true);
@@ -1397,7 +1857,10 @@ void mouseFunc(int button, int state, int x, int y){
                 if (selectedCloud < 0){
                     //search for selections
                     resizeDir = false;//set resize direction to horizontal
-                    for (int i = 0; i < soundViews->size(); i++){
+                    RectGridWalk walk;
+                    unsigned int i;
+                    rectGrid->first(mouseX,mouseY,walk);
+                    while (rectGrid->next(walk,i)){
                         if (soundViews->at(i)->select(mouseX,mouseY) == true){
                             selectionIndices->push_back(i);
                             //soundViews->at(i)->setSelectState(true);
@@ -1574,14 +2037,29 @@ int main (int argc, char ** argv)
     
     
     
-    //create visual representation of sounds    
+    //create visual representation of sounds (indexed on a screen grid, with
+    //room for the bounces)
+    rectGrid = new RectGrid(glutGet(GLUT_SCREEN_WIDTH), glutGet(GLUT_SCREEN_HEIGHT), mySounds->size() + MAX_BOUNCES);
     soundViews = new vector<SoundRect *>;
     for (int i = 0; i < mySounds->size(); i++)
     {
         soundViews->push_back(new SoundRect());
         soundViews->at(i)->associateSound(mySounds->at(i)->wave,mySounds->at(i)->frames,mySounds->at(i)->channels);
+        soundViews->at(i)->setGrid(rectGrid, i);
     }
     
+    //room for bounced clouds, so the sound and rectangle vectors never move
+    //while the audio thread reads them
+    mySounds->reserve(mySounds->size() + MAX_BOUNCES);
+    soundViews->reserve(soundViews->size() + MAX_BOUNCES);
+    numSharedSounds.store((unsigned int) mySounds->size(), std::memory_order_release);
+    loopPlayers = new vector<LoopPlayer *>;
+    loopPlayers->reserve(MAX_BOUNCES);
+    
+    //voice pool (every voice allocated here, before audio starts)
+    voicePool = new GrainVoiceBank(mySounds, MAX_POLYPHONY);
+    voicePool->setSoundCount(&numSharedSounds);
+    
     //init grain cloud vector and corresponding view vector
     grainCloud = new vector<GrainCluster *>;
     grainCloudVis = new vector<GrainClusterVis *>;
@@ -1590,6 +2068,11 @@ int main (int argc, char ** argv)
     
     //-------------Audio Configuration-----------//
     
+    //master limiter (before the stream starts calling back)
+    masterLimiter = new Limiter();
+    if (LOAD_GOVERNOR)
+        loadGovernor = new Governor(ENGINE_BLOCK*samp_time_sec);
+    
     //configure RtAudio
     //create the object
     try {
@@ -1604,6 +2087,21 @@ int main (int argc, char ** argv)
         theAudio->openStream(&audioCallback);
         //get new buffer size
         g_buffSize = theAudio->getBufferSize();
+        //look-ahead rendering - fill the ring before the first callback.
+        //at least one device buffer (plus a block) must be queued
+        if (RENDER_AHEAD_BLOCKS > 0){
+            renderAheadFrames = RENDER_AHEAD_BLOCKS * ENGINE_BLOCK;
+            if (renderAheadFrames < g_buffSize + ENGINE_BLOCK)
+                renderAheadFrames = (g_buffSize / ENGINE_BLOCK + 2) * ENGINE_BLOCK;
+            renderRing = new AudioRing(renderAheadFrames);
+            renderRunning = true;
+            renderThread = new Thread();
+            renderThread->start(&renderLoop, NULL);
+            //the stream starts once the ring is full
+            while (renderRing->readable() < renderAheadFrames)
+                Stk::sleep(1);
+            cout << "rendering " << renderAheadFrames << " frames ahead" << endl;
+        }
         //start audio stream
         theAudio->startStream();
         //report latency
@@ -0,0 +1,265 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  CloudBounce.cpp
+//  Borderlands
+//
+
+#include "CloudBounce.h"
+#include <sstream>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+CloudBounce::CloudBounce(GrainCluster * theCloud, GrainClusterVis * theVis, vector<AudioFile *> * soundSet,
+                         vector<SoundRect *> * rects, double theSeconds, unsigned int theNumber)
+{
+    cloudId = theCloud->getId();
+    unsigned int numVoices = theCloud->getNumVoices();
+
+    //a copy of the cloud with voices of its own, so the live pool is untouched
+    pool = new GrainVoiceBank(soundSet, MAX_POLYPHONY);
+    pool->setSoundCount(theVis->getSoundCount());
+    cloud = new GrainCluster(soundSet, numVoices, pool);
+    cloudVis = new GrainClusterVis(theVis->getX(), theVis->getY(), numVoices, rects, theVis->getRectGrid());
+    cloudVis->setSoundCount(theVis->getSoundCount());
+    cloudVis->setRandExtent(theVis->getX() + theVis->getXRandExtent(), theVis->getY() + theVis->getYRandExtent());
+    cloud->registerVis(cloudVis);
+    cloud->copySettings(theCloud);
+    cloud->setClock(&clock);
+    startTime = GTime::instance().sec;
+
+    //lengths - the copy starts empty, so let it settle for two grains first
+    if (theSeconds < BOUNCE_XFADE_SECS * 2.0)
+        theSeconds = BOUNCE_XFADE_SECS * 2.0;
+    if (theSeconds > BOUNCE_MAX_SECS)
+        theSeconds = BOUNCE_MAX_SECS;
+    double settle = 2.0 * 0.001 * theCloud->getDurationMs();
+    if (settle > 2.0)
+        settle = 2.0;
+    loopFrames = (unsigned long) (theSeconds * MY_SRATE);
+    fadeFrames = (unsigned long) (BOUNCE_XFADE_SECS * MY_SRATE);
+    prerollFrames = (unsigned long) (settle * MY_SRATE);
+    //the first kept frame plays at startTime on the copy's clock
+    clock = startTime - prerollFrames / (double) MY_SRATE;
+
+    ostringstream theName;
+    theName << "bounce" << theNumber;
+    name = theName.str();
+
+    renderThread = NULL;
+    file = NULL;
+    framesDone = 0;
+    done = false;
+    cancel = false;
+}
+
+CloudBounce::~CloudBounce()
+{
+    cancel = true;
+    if (renderThread != NULL){
+        renderThread->wait();
+        delete renderThread;
+    }
+    //the cloud takes its visualization with it and lets go of its voices
+    delete cloud;
+    delete pool;
+    if (file != NULL)
+        delete file;
+}
+
+
+//-----------------------------------------------------------------------------
+// Background rendering
+//-----------------------------------------------------------------------------
+bool CloudBounce::start()
+{
+    if (renderThread != NULL)
+        return false;
+    renderThread = new Thread();
+    return renderThread->start(&CloudBounce::bounceThread, this);
+}
+
+THREAD_RETURN THREAD_TYPE CloudBounce::bounceThread(void * ptr)
+{
+    ((CloudBounce *) ptr)->render();
+    return 0;
+}
+
+void CloudBounce::render()
+{
+    SAMPLE block[ENGINE_BLOCK*MY_CHANNELS];
+    const unsigned long keep = loopFrames + fadeFrames;
+    const unsigned long total = prerollFrames + keep;
+    SAMPLE * wave = new SAMPLE[keep*MY_CHANNELS];
+
+    //same engine blocks as live playback - frames before prerollFrames are
+    //thrown away
+    for (unsigned long f = 0; (f < total) && !cancel; f += ENGINE_BLOCK){
+        memset(block, 0, sizeof(SAMPLE)*ENGINE_BLOCK*MY_CHANNELS);
+        cloud->nextBuffer(block, ENGINE_BLOCK);
+        clock += ENGINE_BLOCK / (double) MY_SRATE;
+
+        unsigned long from = (f < prerollFrames) ? prerollFrames - f : 0;
+        unsigned long to = (total - f < ENGINE_BLOCK) ? total - f : ENGINE_BLOCK;
+        if (from < to)
+            memcpy(wave + (f + from - prerollFrames)*MY_CHANNELS, block + from*MY_CHANNELS, sizeof(SAMPLE)*(to - from)*MY_CHANNELS);
+        framesDone = f + to;
+    }
+    if (cancel){
+        delete [] wave;
+        return;
+    }
+
+    //fold the tail over the head (equal power - the grains on either side
+    //are unrelated), so the end runs straight into the start
+    for (unsigned long i = 0; i < fadeFrames; i++){
+        SAMPLE gIn, gOut;
+        equalPowerGains(i, fadeFrames, gIn, gOut);
+        for (int k = 0; k < MY_CHANNELS; k++)
+            wave[i*MY_CHANNELS + k] = wave[i*MY_CHANNELS + k] * gIn + wave[(loopFrames + i)*MY_CHANNELS + k] * gOut;
+    }
+
+    AudioFile * theFile = new AudioFile(name, "", MY_CHANNELS, loopFrames, MY_SRATE, wave);
+    if (MIPMAP_OCTAVES > 0)
+        AudioFileSet::buildOctaves(theFile, MIPMAP_OCTAVES);
+    file = theFile;
+    done = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// State
+//-----------------------------------------------------------------------------
+bool CloudBounce::isDone()
+{
+    return done;
+}
+
+float CloudBounce::getProgress()
+{
+    return (float) framesDone / (float) (prerollFrames + loopFrames + fadeFrames);
+}
+
+AudioFile * CloudBounce::takeFile()
+{
+    if (!done)
+        return NULL;
+    AudioFile * theFile = file;
+    file = NULL;
+    return theFile;
+}
+
+unsigned int CloudBounce::getCloudId()
+{
+    return cloudId;
+}
+
+double CloudBounce::getStartTime()
+{
+    return startTime;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// Loop player
+//-----------------------------------------------------------------------------
+LoopPlayer::LoopPlayer(AudioFile * theFile, unsigned int theCloudId, GrainCluster * theCloud, double theStartTime)
+{
+    file = theFile;
+    cloudId = theCloudId;
+    pos = 0;
+    isActive = true;
+    cloud = theCloud;
+    startTime = theStartTime;
+    started = false;
+    fadeFrames = (unsigned long) (BOUNCE_XFADE_SECS * MY_SRATE);
+    fadePos = 0;
+}
+
+LoopPlayer::~LoopPlayer()
+{
+}
+
+void LoopPlayer::nextBuffer(SAMPLE * accumBuff, unsigned int numFrames)
+{
+    if (!isActive || (file->frames == 0))
+        return;
+
+    //first block: join the cloud's timeline and start the handover
+    if (!started){
+        started = true;
+        double elapsed = GTime::instance().sec - startTime;
+        if (elapsed > 0.0)
+            pos = (unsigned long) (elapsed * MY_SRATE + 0.5) % file->frames;
+        if (cloud != NULL)
+            cloud->fadeOut(fadeFrames);
+        cloud = NULL;
+    }
+
+    const SAMPLE * wave = file->wave;
+    unsigned int done = 0;
+    while (done < numFrames){
+        unsigned long n = file->frames - pos;
+        if (n > numFrames - done)
+            n = numFrames - done;
+        const SAMPLE * in = wave + pos*MY_CHANNELS;
+        SAMPLE * out = accumBuff + done*MY_CHANNELS;
+        if (fadePos < fadeFrames){
+            for (unsigned long i = 0; i < n; i++){
+                SAMPLE gIn = 1, gOut;
+                if (fadePos < fadeFrames)
+                    equalPowerGains(fadePos++, fadeFrames, gIn, gOut);
+                for (int k = 0; k < MY_CHANNELS; k++)
+                    out[i*MY_CHANNELS + k] += in[i*MY_CHANNELS + k] * gIn;
+            }
+        }else{
+            for (unsigned long i = 0; i < n*MY_CHANNELS; i++)
+                out[i] += in[i];
+        }
+        pos += n;
+        if (pos >= file->frames)
+            pos = 0;
+        done += n;
+    }
+}
+
+void LoopPlayer::setActive(bool on)
+{
+    isActive = on;
+}
+
+bool LoopPlayer::getActiveState()
+{
+    return isActive;
+}
+
+unsigned int LoopPlayer::getCloudId()
+{
+    return cloudId;
+}
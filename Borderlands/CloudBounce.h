@@ -0,0 +1,148 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  CloudBounce.h
+//  Borderlands
+//
+//  Freezing a cloud: CloudBounce renders a copy of a cloud offline, on its
+//  own thread and with its own voice pool, into a new AudioFile that loops
+//  seamlessly (the tail is crossfaded into the head).  The GUI thread picks
+//  the file up when it is done, adds it to the landscape and swaps the live
+//  cloud for a LoopPlayer, which costs one copy per block.  Loop frame 0 is
+//  the live cloud at the moment the bounce started (the copy's LFOs follow
+//  the same clock), so the loop comes in where the cloud has got to and
+//  crossfades with it.
+//
+
+
+#ifndef CLOUDBOUNCE_H
+#define CLOUDBOUNCE_H
+
+#include "theglobals.h"
+#include "AudioFileSet.h"
+#include "GrainCluster.h"
+#include "GrainVoiceBank.h"
+#include "SoundRect.h"
+#include "Thread.h"
+#include <atomic>
+#include <vector>
+
+//default bounce length (seconds), and the loop crossfade (seconds)
+#define BOUNCE_DEFAULT_SECS 10.0
+#define BOUNCE_XFADE_SECS 0.25
+
+//longest bounce (seconds)
+#define BOUNCE_MAX_SECS 300.0
+
+
+class CloudBounce
+{
+public:
+    //destructor (stops and waits for the render thread)
+    virtual ~CloudBounce();
+
+    //constructor - copies the cloud and its visualization (GUI thread)
+    CloudBounce(GrainCluster * theCloud, GrainClusterVis * theVis, vector<AudioFile *> * soundSet,
+                vector<SoundRect *> * rects, double theSeconds, unsigned int theNumber);
+
+    //start rendering in the background
+    bool start();
+
+    //finished?  fraction rendered so far
+    bool isDone();
+    float getProgress();
+
+    //hand over the finished file (once, NULL before it is done)
+    AudioFile * takeFile();
+
+    //the cloud that was bounced, and the GTime its loop starts at
+    unsigned int getCloudId();
+    double getStartTime();
+
+protected:
+    //render the whole file (bounce thread)
+    void render();
+
+    static THREAD_RETURN THREAD_TYPE bounceThread(void * ptr);
+
+private:
+    //offline copy and the voices it plays in
+    GrainCluster * cloud;
+    GrainClusterVis * cloudVis;
+    GrainVoiceBank * pool;
+    unsigned int cloudId;
+    double startTime;
+
+    //offline clock (seconds) for the copy's LFOs
+    double clock;
+
+    //frames of the finished loop, the crossfade and the settle time before it
+    unsigned long loopFrames, fadeFrames, prerollFrames;
+    string name;
+
+    Thread * renderThread;
+    AudioFile * file;
+    std::atomic<unsigned long> framesDone;
+    std::atomic<bool> done, cancel;
+};
+
+
+//loops a bounced file into the output in place of the cloud
+class LoopPlayer
+{
+public:
+    //destructor
+    virtual ~LoopPlayer();
+
+    //constructor (theFile has MY_CHANNELS channels, frame 0 at GTime
+    //theStartTime).  the loop fades in over BOUNCE_XFADE_SECS as theCloud (if
+    //not NULL) fades out
+    LoopPlayer(AudioFile * theFile, unsigned int theCloudId, GrainCluster * theCloud, double theStartTime);
+
+    //add the next numFrames frames into an interleaved buffer (render
+    //before the clouds, so the handover starts in the same block)
+    void nextBuffer(SAMPLE * accumBuff, unsigned int numFrames);
+
+    //on/off
+    void setActive(bool on);
+    bool getActiveState();
+
+    //cloud it stands in for
+    unsigned int getCloudId();
+
+private:
+    AudioFile * file;
+    unsigned long pos;
+    unsigned int cloudId;
+    std::atomic<bool> isActive;
+
+    //handover: the cloud to fade out, and the fade in of the loop
+    GrainCluster * cloud;
+    double startTime;
+    bool started;
+    unsigned long fadeFrames, fadePos;
+};
+
+
+#endif
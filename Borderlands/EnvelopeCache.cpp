@@ -0,0 +1,247 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  EnvelopeCache.cpp
+//  Borderlands
+//
+
+#include "EnvelopeCache.h"
+
+
+//builder thread routine - polls for requests
+static THREAD_RETURN THREAD_TYPE envelopeBuilder(void * ptr)
+{
+    EnvelopeCache * cache = (EnvelopeCache *) ptr;
+    while (true){
+        Thread::test();
+        cache->update();
+        Stk::sleep(5);
+    }
+    return 0;
+}
+
+
+//destructor
+EnvelopeCache::~EnvelopeCache()
+{
+    //stops the builder
+    delete builder;
+
+    for (unsigned int i = 0; i < entries->size(); i++){
+        grainFree(entries->at(i)->data);
+        delete entries->at(i);
+    }
+    delete entries;
+    delete myLock;
+}
+
+
+//constructor
+EnvelopeCache::EnvelopeCache()
+{
+    entries = new vector<GrainEnvelope *>;
+    entries->reserve(ENV_CACHE_MAX_ENTRIES);
+    numPending = 0;
+    useCounter = 0;
+    myLock = new Mutex();
+
+    builder = new Thread();
+    builder->start((THREAD_FUNCTION) &envelopeBuilder, this);
+}
+
+
+//created once, thread safely, on first use (GrainVoiceBank makes sure that
+//happens before any audio thread can get here)
+EnvelopeCache & EnvelopeCache::Instance()
+{
+    static EnvelopeCache * theCache = new EnvelopeCache();
+
+    return *theCache;
+}
+
+
+//-----------------------------------------------------------------------------
+// Requests
+//-----------------------------------------------------------------------------
+void EnvelopeCache::request(unsigned int windowType, unsigned long lengthSamps)
+{
+    if (lengthSamps == 0)
+        return;
+    myLock->lock();
+    if (find(windowType, lengthSamps) == NULL)
+        queueRequest(windowType, lengthSamps);
+    myLock->unlock();
+}
+
+void EnvelopeCache::queueRequest(unsigned int windowType, unsigned long lengthSamps)
+{
+    for (unsigned int i = 0; i < numPending; i++){
+        if ((pendingType[i] == windowType) && (pendingLength[i] == lengthSamps))
+            return;
+    }
+    //if the queue is full the request is dropped - the next lookup asks again
+    if (numPending < ENV_CACHE_MAX_PENDING){
+        pendingType[numPending] = windowType;
+        pendingLength[numPending] = lengthSamps;
+        numPending++;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Lookup (audio thread)
+//-----------------------------------------------------------------------------
+GrainEnvelope * EnvelopeCache::find(unsigned int windowType, unsigned long lengthSamps)
+{
+    for (unsigned int i = 0; i < entries->size(); i++){
+        GrainEnvelope * env = entries->at(i);
+        if ((env->windowType == windowType) && (env->lengthSamps == lengthSamps))
+            return env;
+    }
+    return NULL;
+}
+
+GrainEnvelope * EnvelopeCache::acquire(unsigned int windowType, unsigned long lengthSamps)
+{
+    //builder is busy - play this grain from the window table
+    if (myLock->tryLock() == false)
+        return NULL;
+
+    GrainEnvelope * env = find(windowType, lengthSamps);
+    if (env != NULL){
+        __sync_fetch_and_add(&env->refs, 1);
+        env->lastUse = ++useCounter;
+    }else if (lengthSamps > 0){
+        queueRequest(windowType, lengthSamps);
+    }
+    myLock->unlock();
+    return env;
+}
+
+void EnvelopeCache::release(GrainEnvelope * env)
+{
+    if (env != NULL)
+        __sync_fetch_and_sub(&env->refs, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Builder thread
+//-----------------------------------------------------------------------------
+void EnvelopeCache::update()
+{
+    //take the queued requests
+    unsigned int types[ENV_CACHE_MAX_PENDING];
+    unsigned long lengths[ENV_CACHE_MAX_PENDING];
+    myLock->lock();
+    unsigned int count = numPending;
+    for (unsigned int i = 0; i < count; i++){
+        types[i] = pendingType[i];
+        lengths[i] = pendingLength[i];
+    }
+    numPending = 0;
+    myLock->unlock();
+
+    if (count == 0)
+        return;
+
+    for (unsigned int i = 0; i < count; i++){
+        myLock->lock();
+        bool cached = (find(types[i], lengths[i]) != NULL);
+        myLock->unlock();
+        if (cached)
+            continue;
+
+        //build without holding the lock
+        GrainEnvelope * env = build(types[i], lengths[i]);
+
+        myLock->lock();
+        env->lastUse = ++useCounter;
+        entries->push_back(env);
+        myLock->unlock();
+    }
+
+    myLock->lock();
+    evict();
+    myLock->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Resample the window to the grain length.  The reader is the same fixed
+// point phase a voice reading the table uses, so both paths produce the
+// same envelope.
+//-----------------------------------------------------------------------------
+GrainEnvelope * EnvelopeCache::build(unsigned int windowType, unsigned long lengthSamps)
+{
+    const SAMPLE * window = Window::Instance().getWindow(windowType);
+    GrainPhase inc = grainPhase((double) WINDOW_LEN / (double) lengthSamps);
+
+    //frames until the window ends
+    unsigned long frames = (unsigned long) (grainPhaseFrames(WINDOW_LEN - 1) / inc) + 1;
+
+    GrainEnvelope * env = new GrainEnvelope;
+    env->windowType = windowType;
+    env->lengthSamps = lengthSamps;
+    env->frames = frames;
+    env->refs = 0;
+    env->lastUse = 0;
+    //padding lets the last run read whole vectors
+    env->data = (SAMPLE *) grainAlloc(sizeof(SAMPLE) * (frames + GRAIN_BLOCK));
+
+    for (unsigned long done = 0; done < frames; done += GRAIN_BLOCK){
+        int n = (frames - done < GRAIN_BLOCK) ? (int) (frames - done) : GRAIN_BLOCK;
+        grainEnvelope(window, (GrainPhase) done * inc, inc, env->data + done, n);
+    }
+
+    return env;
+}
+
+
+//-----------------------------------------------------------------------------
+// LRU eviction of envelopes no voice is playing
+//-----------------------------------------------------------------------------
+void EnvelopeCache::evict()
+{
+    unsigned long totalSamps = 0;
+    for (unsigned int i = 0; i < entries->size(); i++)
+        totalSamps += entries->at(i)->frames;
+
+    while ((entries->size() > ENV_CACHE_MAX_ENTRIES) || (totalSamps > ENV_CACHE_MAX_SAMPS)){
+        int oldest = -1;
+        for (unsigned int i = 0; i < entries->size(); i++){
+            GrainEnvelope * env = entries->at(i);
+            if ((env->refs == 0) && ((oldest < 0) || (env->lastUse < entries->at(oldest)->lastUse)))
+                oldest = i;
+        }
+        //everything left is in use
+        if (oldest < 0)
+            break;
+
+        GrainEnvelope * victim = entries->at(oldest);
+        totalSamps -= victim->frames;
+        entries->erase(entries->begin() + oldest);
+        grainFree(victim->data);
+        delete victim;
+    }
+}
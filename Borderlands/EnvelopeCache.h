@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  EnvelopeCache.h
+//  Borderlands
+//
+//  Grain envelopes resampled to the exact grain length, shared by every
+//  voice playing the same (window type, duration) pair.  Envelopes are built
+//  by a background thread; the audio thread only looks them up (without
+//  blocking) and falls back to reading the window table while an envelope
+//  is not ready.  Unused envelopes are evicted least recently used first.
+//
+
+
+#ifndef ENVELOPECACHE_H
+#define ENVELOPECACHE_H
+
+#include "theglobals.h"
+#include "Window.h"
+#include "Thread.h"
+#include "GrainKernels.h"
+#include <vector>
+
+using namespace std;
+
+//most envelopes kept around / total samples held by unused envelopes
+#define ENV_CACHE_MAX_ENTRIES 64
+#define ENV_CACHE_MAX_SAMPS (4*1024*1024)
+
+//requests waiting for the builder thread
+#define ENV_CACHE_MAX_PENDING 64
+
+
+//one prebuilt envelope
+struct GrainEnvelope
+{
+    //key
+    unsigned int windowType;
+    unsigned long lengthSamps;
+
+    //frames until the window ends, samples (zero padded by GRAIN_BLOCK)
+    unsigned long frames;
+    SAMPLE * data;
+
+    //voices holding this envelope, last lookup (for LRU eviction)
+    volatile int refs;
+    unsigned long lastUse;
+};
+
+
+class EnvelopeCache
+{
+public:
+    static EnvelopeCache & Instance();
+
+    //ask for an envelope to be built (gui thread)
+    void request(unsigned int windowType, unsigned long lengthSamps);
+
+    //audio thread - reference a built envelope.  never blocks, returns NULL
+    //(and queues a request) if the envelope is not ready
+    GrainEnvelope * acquire(unsigned int windowType, unsigned long lengthSamps);
+
+    //audio thread - drop a reference
+    void release(GrainEnvelope * env);
+
+    //builder thread - build queued envelopes, evict unused ones
+    void update();
+
+protected:
+    //queue a request (lock must be held)
+    void queueRequest(unsigned int windowType, unsigned long lengthSamps);
+
+    //find an entry (lock must be held)
+    GrainEnvelope * find(unsigned int windowType, unsigned long lengthSamps);
+
+    //resample window to the grain length
+    GrainEnvelope * build(unsigned int windowType, unsigned long lengthSamps);
+
+    //drop least recently used unreferenced entries until within budget (lock must be held)
+    void evict();
+
+private:
+    ~EnvelopeCache();
+    EnvelopeCache();
+
+    //built envelopes
+    vector<GrainEnvelope *> * entries;
+
+    //pending requests (fixed size so the audio thread never allocates)
+    unsigned int pendingType[ENV_CACHE_MAX_PENDING];
+    unsigned long pendingLength[ENV_CACHE_MAX_PENDING];
+    unsigned int numPending;
+
+    //lookup counter for LRU
+    unsigned long useCounter;
+
+    Mutex * myLock;
+    Thread * builder;
+};
+
+
+#endif
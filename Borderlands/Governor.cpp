@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  Governor.cpp
+//  Borderlands
+//
+
+#include "Governor.h"
+#include <math.h>
+
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+Governor::Governor(double theBlockSecs)
+{
+    blockSecs = theBlockSecs;
+    smoothCoef = 1.0 - exp(-blockSecs / (GOVERN_SMOOTH_MS * 0.001));
+    load = 0.0;
+    overSecs = 0.0;
+    underSecs = 0.0;
+    stage = GOVERN_FULL;
+    enabled = true;
+}
+
+Governor::~Governor()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Track the load and move at most one stage per threshold period
+//-----------------------------------------------------------------------------
+int Governor::update(double renderSecs)
+{
+    load += smoothCoef * (renderSecs / blockSecs - load);
+    if (!enabled)
+        return stage;
+
+    if (load > GOVERN_HIGH_LOAD){
+        overSecs += blockSecs;
+        underSecs = 0.0;
+        if ((overSecs >= GOVERN_DEGRADE_MS * 0.001) && (stage < NUM_GOVERN_STAGES - 1)){
+            stage++;
+            overSecs = 0.0;
+        }
+    }else if (load < GOVERN_LOW_LOAD){
+        underSecs += blockSecs;
+        overSecs = 0.0;
+        if ((underSecs >= GOVERN_RECOVER_MS * 0.001) && (stage > GOVERN_FULL)){
+            stage--;
+            underSecs = 0.0;
+        }
+    }else{
+        //in between - hold the stage
+        overSecs = 0.0;
+        underSecs = 0.0;
+    }
+    return stage;
+}
+
+
+//-----------------------------------------------------------------------------
+// Accessors
+//-----------------------------------------------------------------------------
+int Governor::getStage()
+{
+    return stage;
+}
+
+double Governor::getLoad()
+{
+    return load;
+}
+
+void Governor::setEnabled(bool on)
+{
+    enabled = on;
+    if (!enabled){
+        stage = GOVERN_FULL;
+        overSecs = 0.0;
+        underSecs = 0.0;
+    }
+}
+
+bool Governor::getEnabled()
+{
+    return enabled;
+}
@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  Governor.h
+//  Borderlands
+//
+//  Load governor: compares the time spent rendering each engine block with
+//  the time the block lasts.  While the smoothed load stays high the engine
+//  sheds work one stage at a time (linear interpolation for new grains, a
+//  cap on voices per cloud, then thinning the grains of low priority
+//  clouds); it steps back up only after the load has stayed well below the
+//  limit for much longer, so the stage does not flap around a threshold.
+//
+
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include "theglobals.h"
+
+//degradation stages (each includes the ones before it)
+enum {GOVERN_FULL, GOVERN_INTERP, GOVERN_VOICES, GOVERN_THIN, NUM_GOVERN_STAGES};
+
+//load (render time / block time) above which the governor steps down, and
+//below which it may step back up
+#define GOVERN_HIGH_LOAD 0.8
+#define GOVERN_LOW_LOAD 0.5
+
+//how long the load must stay past a threshold before the stage changes (ms)
+#define GOVERN_DEGRADE_MS 100.0
+#define GOVERN_RECOVER_MS 2000.0
+
+//load smoothing time constant (ms)
+#define GOVERN_SMOOTH_MS 50.0
+
+//voices per cloud at GOVERN_VOICES and above, and the fraction of grains
+//low priority clouds keep at GOVERN_THIN (1 in GOVERN_THIN_FACTOR)
+#define GOVERN_CLOUD_VOICES 32
+#define GOVERN_THIN_FACTOR 2
+
+
+class Governor
+{
+public:
+    //destructor
+    virtual ~Governor();
+
+    //constructor (length of the blocks it will be told about, seconds)
+    Governor(double theBlockSecs);
+
+    //time spent rendering the last block (seconds) - returns the stage
+    int update(double renderSecs);
+
+    //current stage (GOVERN_*) and smoothed load
+    int getStage();
+    double getLoad();
+
+    //switch off (stays at GOVERN_FULL)
+    void setEnabled(bool on);
+    bool getEnabled();
+
+private:
+    double blockSecs;
+    double smoothCoef;
+    double load;
+    //time the load has been past the high / below the low threshold (seconds)
+    double overSecs, underSecs;
+    int stage;
+    bool enabled;
+};
+
+
+#endif
@@ -35,11 +35,13 @@
 GrainCluster::~GrainCluster()
 {
     if (myGrains !=NULL){
-        for (int i = 0; i < myGrains->size(); i++){
+        for (unsigned int i = 0; i < myGrains->size(); i++){
             delete myGrains->at(i);
         }
         delete myGrains;
     }
+    //our grains were stopped on the render thread (releaseVoices) before
+    //we were deleted - the pool itself is shared
     
     if (myVis)
         delete myVis;
@@ -47,21 +49,20 @@ GrainCluster::~GrainCluster()
         delete myLock; 
     if (channelMults)
         delete[] channelMults;
+    if (bus)
+        grainFree(bus);
 }
 
 
 
 //Constructor
-GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices)
+GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices, GrainVoiceBank * thePool)
 {
   //initialize mutext
     myLock = new Mutex();
     //cluster id
     myId = ++clusterId;
     
-    //playback bool to make sure we precisely time grain triggers
-    awaitingPlay = false;
-    
     //number of voices
     numVoices = theNumVoices;
     //initialize random number generator (for random motion)
@@ -79,6 +80,7 @@ GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices)
     
     //intialize timer
     local_time = 0;
+    clock = &GTime::instance().sec;
 
     //default duration (ms)
     duration = 500.0;
@@ -89,6 +91,10 @@ GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices)
     //default window type
     windowType = HANNING;
     
+    //default interpolation (sinc tables are built here, off the audio thread)
+    interpQuality = INTERP_LINEAR;
+    grainInterpInit();
+    
     //initialize pitch LFO
     pitchLFOFreq = 0.01f;
     pitchLFOAmount = 0.0f;
@@ -109,17 +115,36 @@ GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices)
     
     myDirMode = RANDOM_DIR;
  
-    //create grain voice vector
+    //create grain voice vector.  playback state lives in the shared pool
     myGrains = new vector<GrainVoice *>;
+    voicePool = thePool;
+    priority = 0;
+    thinning = 1;
+    thinCount = 0;
+    voiceFrames = 0;
+    skippedFrames = 0;
+    
+    //settings every voice of the cloud reads
+    params.version.store(0);
+    publishParams();
     
     //populate grain cloud
-    for (int i = 0; i < numVoices; i++)
+    for (unsigned int i = 0; i < numVoices; i++)
     {
-        myGrains->push_back(new GrainVoice( theSounds, duration, pitch));
+        myGrains->push_back(new GrainVoice( voicePool, &params, pitch));
     }
 
+    //cloud mix bus (allocated on the first buffer)
+    bus = NULL;
+    busFrames = 0;
+    
     //set volume of cloud to unity
     setVolumeDb(0.0);
+    busVol = normedVol;
+    
+    //onsets follow overlap until an asynchronous density mode is chosen
+    densityMode = DENSITY_OVERLAP;
+    grainRate = 20.0f;
     
     //set overlap (default to full overlap)
     setOverlap(1.0f);
@@ -130,13 +155,15 @@ GrainCluster::GrainCluster(vector<AudioFile*> * soundSet, float theNumVoices)
     //initialize trigger time (samples)
     bang_time = duration * MY_SRATE * (double) 0.001 / overlap;    
 
-    //load grains
-    for (int i = 0; i < myGrains->size(); i++){
-        myGrains->at(i)->setDurationMs(duration);
-    }
+    //prepare envelopes
+    requestEnvelopes();
     
     //state - (user can remove cloud from "play" for editing)
     isActive = true;
+    releaseFlag = false;
+    fading = false;
+    fadeFrames = 0;
+    fadePos = 0;
     
 
     
@@ -151,14 +178,34 @@ void GrainCluster::registerVis(GrainClusterVis * vis){
 
 //turn on/off
 void GrainCluster::toggleActive(){
+    fading = false;
     isActive = !isActive;
-
+    //switched off - the render thread stops our grains, so switching back on
+    //starts clean
+    if (isActive == false)
+        releaseFlag = true;
 }
 
 bool GrainCluster::getActiveState(){
     return isActive;
 }
 
+//hand over - fade out then switch off
+void GrainCluster::fadeOut(unsigned long theFrames){
+    fadeFrames = (theFrames > 0) ? theFrames : 1;
+    fadePos = 0;
+    fading = true;
+}
+
+void GrainCluster::cancelFade(){
+    fading = false;
+}
+
+//stop our grains in the pool (render thread)
+void GrainCluster::releaseVoices(){
+    voicePool->releaseOwner(myId);
+}
+
 
 
 //set window type
@@ -169,17 +216,9 @@ void GrainCluster::setWindowType(int winType){
     if (windowType < 0){
         windowType = Window::Instance().numWindows()-1;
     }
-    if (windowType == RANDOM_WIN){
-        for (int i = 0; i < myGrains->size();i++){
-            myGrains->at(i)->setWindow((int)floor(randf()*Window::Instance().numWindows()-1));
-        }
-    }else{
-
-        for (int i = 0; i < myGrains->size();i++){
-            //cout << "windowtype " << windowType << endl;
-            myGrains->at(i)->setWindow(windowType);
-        }
-    }
+    //under RANDOM_WIN each voice picks its own
+    publishParams();
+    requestEnvelopes();
 }
 
 int GrainCluster::getWindowType(){
@@ -187,6 +226,20 @@ int GrainCluster::getWindowType(){
 }
 
 
+//set interpolation quality
+void GrainCluster::setInterpolation(int quality){
+    interpQuality = quality % NUM_INTERP;
+    if (interpQuality < 0){
+        interpQuality = NUM_INTERP - 1;
+    }
+    publishParams();
+}
+
+int GrainCluster::getInterpolation(){
+    return interpQuality;
+}
+
+
 void GrainCluster::addGrain(){
     addFlag = true;
     myVis->addGrain();
@@ -199,6 +252,29 @@ void GrainCluster::removeGrain(){
 
 
 //return id for grain cluster
+//copy user settings
+void GrainCluster::copySettings(GrainCluster * source){
+    setDurationMs(source->getDurationMs());
+    setOverlap(source->getOverlap());
+    setPitch(source->getPitch());
+    setPitchLFOFreq(source->getPitchLFOFreq());
+    setPitchLFOAmount(source->getPitchLFOAmount());
+    setDirection(source->getDirection());
+    setWindowType(source->getWindowType());
+    setInterpolation(source->getInterpolation());
+    setSpatialMode(source->getSpatialMode(), source->getSpatialChannel());
+    setVolumeDb(source->getVolumeDb());
+    busVol = normedVol;
+    setDensityMode(source->getDensityMode());
+    setGrainRate(source->getGrainRate());
+    setPriority(source->getPriority());
+}
+
+//LFO clock
+void GrainCluster::setClock(const double * theClock){
+    clock = theClock;
+}
+
 unsigned int GrainCluster::getId(){
     return myId;
 }
@@ -231,10 +307,10 @@ void GrainCluster::setDurationMs(float theDur)
 {
     if (theDur >=1.0f){
         duration = theDur;
-        for (int i = 0; i < myGrains->size(); i++)
-            myGrains->at(i)->setDurationMs(duration);
+        publishParams();
         
         updateBangTime();
+        requestEnvelopes();
         
         //notify visualization
         if (myVis)
@@ -242,11 +318,80 @@ void GrainCluster::setDurationMs(float theDur)
     }
 }
 
-//update internal grain trigger time
+//update internal grain trigger time (frames to the next onset).  the
+//asynchronous modes draw a new interval for every grain
 void GrainCluster::updateBangTime(){
-    bang_time = duration * MY_SRATE * (double) 0.001 / overlap;
+    double period;
+    switch (densityMode) {
+        case DENSITY_JITTER:
+            period = MY_SRATE / (double) grainRate;
+            bang_time = period * (1.0 + GRAIN_RATE_JITTER * (2.0 * randf() - 1.0));
+            break;
+        case DENSITY_POISSON:
+            //exponential intervals (u in (0,1])
+            period = MY_SRATE / (double) grainRate;
+            bang_time = -log(((double) rand() + 1.0) / ((double) RAND_MAX + 1.0)) * period;
+            break;
+        default:
+            bang_time = duration * MY_SRATE * (double) 0.001 / overlap;
+            break;
+    }
     //cout << "duration: " << duration << ", new bang time " << bang_time << endl;
-    
+
+}
+
+//density mode
+void GrainCluster::setDensityMode(int theMode){
+    densityMode = theMode % NUM_DENSITY_MODES;
+    if (densityMode < 0)
+        densityMode += NUM_DENSITY_MODES;
+    updateBangTime();
+}
+
+int GrainCluster::getDensityMode(){
+    return densityMode;
+}
+
+//grains per second (asynchronous modes)
+void GrainCluster::setGrainRate(float theRate){
+    if (theRate < GRAIN_MIN_RATE)
+        theRate = GRAIN_MIN_RATE;
+    else if (theRate > GRAIN_MAX_RATE)
+        theRate = GRAIN_MAX_RATE;
+    grainRate = theRate;
+    updateBangTime();
+}
+
+float GrainCluster::getGrainRate(){
+    return grainRate;
+}
+
+//build envelopes ahead of the next grains (same length in samples as GrainVoice).
+//shapes the voices compute themselves need no table
+void GrainCluster::requestEnvelopes(){
+    unsigned long lengthSamps = (unsigned long) ceil(duration * MY_SRATE * (double) 0.001);
+    if (windowType == RANDOM_WIN){
+        for (int i = 0; i < RANDOM_WIN; i++){
+            if (!(GRAIN_ANALYTIC_ENVELOPES && grainOscSupported(i)))
+                EnvelopeCache::Instance().request(i, lengthSamps);
+        }
+    }else if (!(GRAIN_ANALYTIC_ENVELOPES && grainOscSupported(windowType))){
+        EnvelopeCache::Instance().request(windowType, lengthSamps);
+    }
+}
+
+
+//write our settings into params (version odd while writing - see
+//GrainParams).  voices copy them at their next trigger
+void GrainCluster::publishParams(){
+    unsigned long version = params.version.load(std::memory_order_relaxed);
+    params.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    params.duration.store(duration, std::memory_order_relaxed);
+    params.windowType.store(windowType, std::memory_order_relaxed);
+    params.direction.store(myDirMode, std::memory_order_relaxed);
+    params.interpQuality.store(interpQuality, std::memory_order_relaxed);
+    params.version.store(version + 2, std::memory_order_release);
 }
 
 
@@ -255,10 +400,8 @@ void GrainCluster::setPitch(float targetPitch){
     if (targetPitch < 0.0001){
         targetPitch = 0.0001;
     }
+    //voices take it as they trigger
     pitch = targetPitch;
-    for (int i = 0; i < myGrains->size(); i++)
-        myGrains->at(i)->setPitch(targetPitch);
-    
 }
 
 float GrainCluster::getPitch(){
@@ -283,11 +426,9 @@ void GrainCluster::setVolumeDb(float volDb)
     
     volumeDb = volDb;
     
-    //convert to 0-1 representation
+    //convert to 0-1 representation (applied to the cloud bus, so sounding
+    //grains follow too)
     normedVol = pow( 10.0 , volDb * 0.05 );
-    
-    for (int i = 0; i < myGrains->size(); i++)
-        myGrains->at(i)->setVolume(normedVol);
 }
 
 float GrainCluster::getVolumeDb()
@@ -304,28 +445,8 @@ void GrainCluster::setDirection(int dirMode){
         myDirMode = 2;
     }
     //cout << "dirmode num" << myDirMode << endl;
-    switch (myDirMode) {
-        case FORWARD:
-      //      cout << "set for" << endl;
-            for (int i = 0; i < myGrains->size(); i++)
-                myGrains->at(i)->setDirection(1.0);
-            break;
-        case BACKWARD:
-        //    cout << "set back" << endl;
-            for (int i = 0; i < myGrains->size(); i++)
-                myGrains->at(i)->setDirection(-1.0);
-            break;
-        case RANDOM_DIR:
-            for (int i = 0; i < myGrains->size(); i++){
-                if (randf() > 0.5)
-                    myGrains->at(i)->setDirection(1.0);
-                else
-                    myGrains->at(i)->setDirection(-1.0);
-            }
-                
-        default:
-            break;
-    }
+    //under RANDOM_DIR each voice picks its own
+    publishParams();
 }
 
 
@@ -345,36 +466,45 @@ unsigned int GrainCluster::getNumVoices(){
     return myGrains->size();
 }
 
+//culling statistics
+unsigned long long GrainCluster::getVoiceFrames(){
+    return voiceFrames;
+}
+
+unsigned long long GrainCluster::getSkippedVoiceFrames(){
+    return skippedFrames;
+}
+
+//voice stealing priority (higher keeps its voices longer)
+void GrainCluster::setPriority(int thePriority){
+    priority = thePriority;
+}
+
+int GrainCluster::getPriority(){
+    return priority;
+}
+
+//load shedding
+void GrainCluster::setThinning(unsigned int theFactor){
+    if (theFactor < 1)
+        theFactor = 1;
+    thinning = theFactor;
+}
+
+unsigned int GrainCluster::getThinning(){
+    return thinning;
+}
+
 
 
 //compute audio
-void GrainCluster::nextBuffer(double * accumBuff,unsigned int numFrames)
+void GrainCluster::nextBuffer(SAMPLE * accumBuff,unsigned int numFrames)
 {
     
     if (addFlag == true){
         addFlag = false;
-        myGrains->push_back(new GrainVoice(theSounds,duration,pitch));
-        int idx = myGrains->size()-1;
-        myGrains->at(idx)->setWindow(windowType);
-        switch (myDirMode) {
-            case FORWARD:
-                myGrains->at(idx)->setDirection(1.0);
-                break;
-            case BACKWARD:
-                myGrains->at(idx)->setDirection(-1.0);
-                break;
-            case RANDOM_DIR:
-                if (randf()>0.5)
-                    myGrains->at(idx)->setDirection(1.0);
-                else
-                    myGrains->at(idx)->setDirection(-1.0);
-                break;
-
-            default:
-                break;
-        }
+        myGrains->push_back(new GrainVoice(voicePool,&params,pitch));
         
-        myGrains->at(idx)->setVolume(normedVol);
         numVoices += 1;
         setOverlap(overlapNorm);
     }
@@ -385,6 +515,7 @@ void GrainCluster::nextBuffer(double * accumBuff,unsigned int numFrames)
              if (nextGrain >= myGrains->size()-1){
                  nextGrain = 0;
              }
+            delete myGrains->back();
             myGrains->pop_back();
             setOverlap(overlapNorm);
         }
@@ -394,80 +525,110 @@ void GrainCluster::nextBuffer(double * accumBuff,unsigned int numFrames)
         
     }
     
+    if (releaseFlag.exchange(false))
+        releaseVoices();
+    
     if (isActive == true){
         
+        //grow the cloud bus to the device buffer (first call, or the buffer got bigger)
+        if (numFrames > busFrames){
+            if (bus)
+                grainFree(bus);
+            busFrames = numFrames;
+            bus = (SAMPLE *) grainAlloc(sizeof(SAMPLE) * busFrames * MY_CHANNELS);
+        }
+        for (int k = 0; k < MY_CHANNELS; k++)
+            memset(bus + k*busFrames, 0, sizeof(SAMPLE) * numFrames);
         
-                //initialize play positions array
-        double playPositions[theSounds->size()];
-        double playVols[theSounds->size()];
-        
-        //buffer variables
-        unsigned int nextFrame = 0;
-        
-        //compute sub_buffers for reduced function calls
-        int frameSkip = numFrames/2;
+        //sounds under the grain being triggered
+        GrainHit hits[MAX_GRAIN_SOURCES];
         
+        //pool statistics before this buffer (ours are the difference)
+        unsigned long long poolFrames = voicePool->getVoiceFrames();
+        unsigned long long poolSkipped = voicePool->getSkippedFrames();
         
-        //fill buffer
-        for (int j = 0; j < (numFrames/(frameSkip)); j++){
+        //start every grain due in this buffer on its exact frame, then render
+        //all of our voices in one pass
+        for (;;){
             
-            //check for bang
-            if ((local_time > bang_time) || (awaitingPlay)){
-                
-                //debug
-                //cout << "bang " << nextGrain << endl;
-                //reset local
-                if (!awaitingPlay){
-                    local_time = 0;
-                    //clear play and volume buffs
-                    for (int i = 0; i < theSounds->size(); i++){
-                        playPositions[i] = (double)(-1.0);
-                        playVols[i] = (double) 0.0;
-                    }
-                    //TODO:  get position vector for grain with idx nextGrain from controller
-                    //udate positions vector (currently randomized)q
-                    if (myVis)
-                        myVis->getTriggerPos(nextGrain,playPositions,playVols,duration);
-                    
-                }
-                
-                //get next pitch (using LFO) -  eventually generalize to an applyLFOs method (if LFO control will be exerted over multiple params)
-                if ((pitchLFOAmount > 0.0f) && (pitchLFOFreq > 0.0f)){
-                    float nextPitch = fabs(pitch + pitchLFOAmount * sin(2*PI*pitchLFOFreq*GTime::instance().sec));
-                    myGrains->at(nextGrain)->setPitch(nextPitch);
-                }
-                
-                
-                //update spatialization/get new channel multiplier set
-                updateSpatialization();
-                myGrains->at(nextGrain)->setChannelMultipliers(channelMults);
-                
-                //trigger grain
-                awaitingPlay =  myGrains->at(nextGrain)->playMe(playPositions,playVols);
-                
-                //only advance if next grain is playable.  otherwise, cycle through again
-                //to wait for playback
-                if (!awaitingPlay){
-                    //queue next grain for trigger
-                    nextGrain++;
-                    //wrap grain idx
-                    if (nextGrain >= myGrains->size())
-                        nextGrain = 0;
-                }else{
-                    //debug
-                    //cout << "playback delayed "<< endl;
-                }
+            //next onset (frames from the start of this buffer, may be fractional)
+            //and the first frame of the grain.  overdue grains start now
+            double onset = bang_time - local_time;
+            double startFrame = ceil(onset);
+            if (startFrame < 0){
+                onset = 0;
+                startFrame = 0;
+            }
+            if (startFrame >= numFrames)
+                break;
+            
+            //TODO:  get position vector for grain with idx nextGrain from controller
+            //udate positions vector (currently randomized)q
+            unsigned int numHits = 0;
+            if (myVis)
+                numHits = myVis->getTriggerPos(nextGrain,hits,MAX_GRAIN_SOURCES,duration);
+            
+            //get next pitch (using LFO) -  eventually generalize to an applyLFOs method (if LFO control will be exerted over multiple params)
+            if ((pitchLFOAmount > 0.0f) && (pitchLFOFreq > 0.0f)){
+                float nextPitch = fabs(pitch + pitchLFOAmount * sin(2*PI*pitchLFOFreq*(*clock)));
+                myGrains->at(nextGrain)->setPitch(nextPitch);
+            }else{
+                myGrains->at(nextGrain)->setPitch(pitch);
+            }
+            
+            
+            //update spatialization/get new channel multiplier set
+            updateSpatialization();
+            myGrains->at(nextGrain)->setChannelMultipliers(channelMults);
+            
+            //trigger grain in a pool voice.  if the pool is full and nothing
+            //can be stolen (or the grain is thinned out) the grain is dropped -
+            //the cloud keeps its timing
+            int slot = -1;
+            if (++thinCount >= thinning){
+                thinCount = 0;
+                slot = voicePool->allocate(myId, priority);
             }
-            //advance time
-            local_time+=frameSkip;
+            if (slot >= 0)
+                myGrains->at(nextGrain)->playMe(slot,hits,numHits,(unsigned int) startFrame,startFrame - onset);
             
-            //sample offset (1 sample at a time for now)
-            nextFrame = j*frameSkip;
-            //iterate over all grains
-            for (int k = 0; k < myGrains->size(); k++){
-                myGrains->at(k)->nextBuffer(accumBuff,frameSkip, nextFrame,k);
+            //next onset is bang_time after this one
+            local_time = -onset;
+            if (densityMode != DENSITY_OVERLAP)
+                updateBangTime();
+            //queue next grain for trigger
+            nextGrain++;
+            //wrap grain idx
+            if (nextGrain >= myGrains->size())
+                nextGrain = 0;
+        }
+        
+        //render our voices and advance time
+        voicePool->nextBuffer(myId,bus,busFrames,numFrames,0);
+        local_time += numFrames;
+        voiceFrames += voicePool->getVoiceFrames() - poolFrames;
+        skippedFrames += voicePool->getSkippedFrames() - poolSkipped;
+        
+        //fading out - ramp the bus down, then stop
+        if (fading){
+            for (unsigned int i = 0; i < numFrames; i++){
+                SAMPLE gIn, gOut = 0;
+                if (fadePos + i < fadeFrames)
+                    equalPowerGains(fadePos + i, fadeFrames, gIn, gOut);
+                for (int k = 0; k < MY_CHANNELS; k++)
+                    bus[k*busFrames + i] *= gOut;
+            }
+            fadePos += numFrames;
+            if (fadePos >= fadeFrames){
+                fading = false;
+                isActive = false;
+                releaseVoices();
             }
         }
+        
+        //cloud volume, interleave into the output
+        grainMixBus(bus, busFrames, busVol, normedVol, accumBuff, numFrames);
+        busVol = normedVol;
     }
 }
 
@@ -586,7 +747,7 @@ GrainClusterVis::~GrainClusterVis(){
         delete myGrainsV;
 }
 
-GrainClusterVis::GrainClusterVis(float x, float y, unsigned int numVoices,vector<SoundRect*>*rects)
+GrainClusterVis::GrainClusterVis(float x, float y, unsigned int numVoices,vector<SoundRect*>*rects,RectGrid * grid)
 {
     //get screen width and height
     screenWidth = glutGet(GLUT_SCREEN_WIDTH);
@@ -617,10 +778,12 @@ GrainClusterVis::GrainClusterVis(float x, float y, unsigned int numVoices,vector
     
     //pointer to landscape visualization objects
     theLandscape = rects;
+    rectGrid = grid;
+    soundCount = NULL;
 
     myGrainsV = new vector<GrainVis *>;
     
-    for (int i = 0; i < numVoices; i++)
+    for (unsigned int i = 0; i < numVoices; i++)
     {
         myGrainsV->push_back(new GrainVis(gcX,gcY));
     }
@@ -686,7 +849,7 @@ void GrainClusterVis::draw()
     glPushMatrix();
     //update grain motion;
     //Individual voices
-     for (int i = 0; i < numGrains; i++){
+     for (unsigned int i = 0; i < numGrains; i++){
        myGrainsV->at(i)->draw();
      }
     glPopMatrix();
@@ -695,31 +858,66 @@ void GrainClusterVis::draw()
 }
 
 
+//add a sound to a grain's hit list.  once maxHits are held the quietest
+//gives way to a louder one
+static unsigned int addHit(GrainHit * theHits, unsigned int numHits, unsigned int maxHits,
+                           unsigned int sound, double position, double volume)
+{
+    unsigned int h = numHits;
+    if (numHits >= maxHits){
+        h = 0;
+        for (unsigned int k = 1; k < numHits; k++){
+            if (fabs(theHits[k].volume) < fabs(theHits[h].volume))
+                h = k;
+        }
+        if (fabs(volume) <= fabs(theHits[h].volume))
+            return numHits;
+    }else{
+        numHits++;
+    }
+    theHits[h].sound = sound;
+    theHits[h].position = position;
+    theHits[h].volume = volume;
+    return numHits;
+}
+
 //get trigger position/volume relative to sound rects for single grain voice
-void GrainClusterVis::getTriggerPos(unsigned int idx, double * playPos, double * playVol,float theDur)
+unsigned int GrainClusterVis::getTriggerPos(unsigned int idx, GrainHit * theHits, unsigned int maxHits, float theDur)
 {
-    bool trigger = false;
-    SoundRect * theRect = NULL;
+    unsigned int numHits = 0;
+    double pos, vol;
     if (idx < myGrainsV->size()){
         GrainVis * theGrain = myGrainsV->at(idx);
         //TODO: motion models
         //updateGrainPosition(idx,gcX + randf()*50.0 + randf()*(-50.0),gcY + randf()*50.0 + randf()*(-50.0));
         updateGrainPosition(idx,gcX + (randf()*xRandExtent - randf()*xRandExtent),gcY + (randf()*yRandExtent - randf()*yRandExtent));
-        for (int i = 0; i < theLandscape->size(); i++) {
-            theRect = theLandscape->at(i);
-            bool tempTrig = false;
-            tempTrig = theRect->getNormedPosition(playPos,playVol,theGrain->getX(),theGrain->getY(),i);
-            if (tempTrig == true)
-                trigger = true;
-            // cout << "playvol: " << *playPos << ", playpos: " << *playVol << endl;
-            
+        float x = theGrain->getX();
+        float y = theGrain->getY();
+        //bounces append rectangles while we run - only read the published
+        //ones, and without at()/size(), which read the end the ui thread moves
+        unsigned int numRects = soundCount ? soundCount->load(std::memory_order_acquire) : (unsigned int) theLandscape->size();
+        if (rectGrid){
+            //only the rectangles sharing the grain's grid cell can hold it
+            RectGridWalk walk;
+            unsigned int i;
+            rectGrid->first(x,y,walk);
+            while (rectGrid->next(walk,i)){
+                if (i >= numRects)
+                    continue;
+                if ((*theLandscape)[i]->getNormedPosition(&pos,&vol,x,y,0))
+                    numHits = addHit(theHits,numHits,maxHits,i,pos,vol);
+            }
+        }else{
+            for (unsigned int i = 0; i < numRects; i++) {
+                if ((*theLandscape)[i]->getNormedPosition(&pos,&vol,x,y,0))
+                    numHits = addHit(theHits,numHits,maxHits,i,pos,vol);
+            }
         }
-        if (trigger == true){
+        if (numHits > 0){
             theGrain->trigger(theDur);
         }
     }
-    
-    
+    return numHits;
 }
 
 
@@ -751,13 +949,28 @@ float GrainClusterVis::getYRandExtent()
     return yRandExtent;
 }
 
+RectGrid * GrainClusterVis::getRectGrid()
+{
+    return rectGrid;
+}
+
+void GrainClusterVis::setSoundCount(const std::atomic<unsigned int> * theCount)
+{
+    soundCount = theCount;
+}
+
+const std::atomic<unsigned int> * GrainClusterVis::getSoundCount()
+{
+    return soundCount;
+}
+
 //
 void GrainClusterVis::updateCloudPosition(float x, float y){
     float xDiff = x - gcX;
     float yDiff = y-gcY;
     gcX = x;
     gcY = y;
-    for (int i = 0; i < myGrainsV->size(); i++){
+    for (unsigned int i = 0; i < myGrainsV->size(); i++){
         float newGrainX = myGrainsV->at(i)->getX() + xDiff;
         float newGrainY = myGrainsV->at(i)->getY() + yDiff;
         myGrainsV->at(i)->moveTo(newGrainX,newGrainY);
@@ -766,7 +979,7 @@ void GrainClusterVis::updateCloudPosition(float x, float y){
 
 void  GrainClusterVis::updateGrainPosition(int idx, float x, float y)
 {
-    if (idx < numGrains)
+    if ((idx >= 0) && ((unsigned int) idx < numGrains))
         myGrainsV->at(idx)->moveTo(x,y);
 }
 
@@ -38,21 +38,38 @@
 #include <time.h>
 #include <ctime>
 #include <Stk.h>
+#include <atomic>
 
 #include "GrainVoice.h"
 #include "theglobals.h"
 #include "Window.h"
+#include "EnvelopeCache.h"
 #include "Thread.h"
 #include "SoundRect.h"
 
-//direction modes
-enum {FORWARD, BACKWARD, RANDOM_DIR};
-
 //spatialization modes
 enum {UNITY, STEREO, AROUND}; //eventually include channel list specification and VBAP?
 
+//density modes - grain onsets from duration/overlap (tied to the number of
+//voices), or at a rate in grains per second with jittered or Poisson spacing
+enum {DENSITY_OVERLAP, DENSITY_JITTER, DENSITY_POISSON, NUM_DENSITY_MODES};
+
+//grain rate range (grains per second) and jitter of the onset spacing
+//(fraction of the mean interval)
+#define GRAIN_MIN_RATE 0.1
+#define GRAIN_MAX_RATE 10000.0
+#define GRAIN_RATE_JITTER 0.5
+
 using namespace std;
 
+//equal power crossfade gains at frame i of n (gIn rises, gOut falls)
+static inline void equalPowerGains(unsigned long i, unsigned long n, SAMPLE & gIn, SAMPLE & gOut)
+{
+    double a = 0.5 * PI * (double) i / (double) n;
+    gIn = (SAMPLE) sin(a);
+    gOut = (SAMPLE) cos(a);
+}
+
 
 //forward declarations
 class GrainCluster;
@@ -70,11 +87,11 @@ public:
     //destructor
     virtual ~GrainCluster();
     
-    //constructor
-    GrainCluster(vector<AudioFile *> *soundSet, float theNumVoices);
+    //constructor (voices play in thePool, shared by all clouds)
+    GrainCluster(vector<AudioFile *> *soundSet, float theNumVoices, GrainVoiceBank * thePool);
     
     //compute next buffer of audio (accumulate from grains)
-    void nextBuffer(double * accumBuff, unsigned int numFrames);
+    void nextBuffer(SAMPLE * accumBuff, unsigned int numFrames);
     
     //CLUSTER PARAMETER accessors/mutators
     // set duration for all grains
@@ -86,6 +103,12 @@ public:
     void setOverlap(float targetOverlap);
     float getOverlap();
     
+    //density mode (wraps around) and grain rate for the asynchronous modes
+    void setDensityMode(int theMode);
+    int getDensityMode();
+    void setGrainRate(float theRate);
+    float getGrainRate();
+    
     //pitch
     void setPitch(float targetPitch);
     float getPitch();
@@ -108,6 +131,20 @@ public:
     void setWindowType(int windowType);
     int getWindowType();
     
+    //set interpolation quality (INTERP_LINEAR, INTERP_CUBIC, INTERP_SINC8, INTERP_SINC16 - wraps around)
+    void setInterpolation(int quality);
+    int getInterpolation();
+    
+    //voice stealing priority - under STEAL_PRIORITY the pool takes voices
+    //from the lowest priority cloud first
+    void setPriority(int thePriority);
+    int getPriority();
+    
+    //load shedding - play only 1 in theFactor grains (1 = all).  onset
+    //timing and positions carry on as if every grain played
+    void setThinning(unsigned int theFactor);
+    unsigned int getThinning();
+    
 
     //spatialization methods (see enum for theMode.  channel number is optional and has default arg); 
     void setSpatialMode(int theMode,int channelNumber);
@@ -119,6 +156,14 @@ public:
     float getVolumeDb();
 
     
+    //take every user setting from another cloud (for offline copies - the
+    //voice count is set at construction)
+    void copySettings(GrainCluster * source);
+    
+    //clock the LFOs follow (seconds, GTime by default) - offline renders
+    //keep their own
+    void setClock(const double * theClock);
+    
     //get unique id of grain cluster    
     unsigned int getId();
     
@@ -128,11 +173,26 @@ public:
     //turn on/off
     void toggleActive();
     bool getActiveState();
+    
+    //fade out over theFrames frames (equal power) and then switch off -
+    //audio thread, for handing over to a loop.  cancelFade (or toggleActive)
+    //stops it
+    void fadeOut(unsigned long theFrames);
+    void cancelFade();
+    
+    //stop this cloud's grains in the voice pool - render thread only.  done
+    //when the cloud is switched off, and before a deleted cloud is freed
+    void releaseVoices();
 
     
     //return number of voices
     unsigned int getNumVoices();
     
+    //voice frames played, and voice frames skipped because their grain had
+    //nothing audible left (this cloud's share of the GrainVoiceBank counts)
+    unsigned long long getVoiceFrames();
+    unsigned long long getSkippedVoiceFrames();
+    
     
 protected:
     //update internal trigger point
@@ -140,16 +200,25 @@ protected:
     
     //spatialization - get new channel multiplier buffer to pass to grain voice instance
     void updateSpatialization();
+
+    //have the envelope cache prepare envelopes for the current window/duration
+    void requestEnvelopes();
+    
+    //copy our settings into params for the voices
+    void publishParams();
     
 private:
     unsigned int myId; //unique id
     
     bool isActive; //on/off state
-    bool awaitingPlay; //triggered but not ready to play?
+    std::atomic<bool> releaseFlag; //switched off - stop our grains
+    std::atomic<bool> fading; //fading out (fadePos of fadeFrames done)
+    unsigned long fadeFrames, fadePos;
     bool addFlag,removeFlag; //add/remove requests submitted?
-    unsigned long local_time; //internal clock
+    double local_time; //frames since the last onset, at the start of the current buffer
     double startTime; //instantiation time
     double bang_time; //trigger time for next grain
+    const double * clock; //LFO time (seconds)
     unsigned int nextGrain; //grain voice index
     
     //spatialization vars    
@@ -169,18 +238,33 @@ private:
     int spatialMode;
     int channelLocation;
 
-    //volume
-    float volumeDb,normedVol;
+    //volume (busVol = volume the bus was last mixed at, for ramping)
+    float volumeDb,normedVol,busVol;
+    
+    //cloud mix bus - voices pan into it (planar, busFrames per channel),
+    //then it is mixed into the output once per buffer
+    SAMPLE * bus;
+    unsigned long busFrames;
     
-    //vector of grains
+    //vector of grains (parameters), the settings they share and the shared
+    //voice pool they play in
     vector<GrainVoice *> * myGrains;
+    GrainParams params;
+    GrainVoiceBank * voicePool;
+    int priority;
+    unsigned int thinning, thinCount;
+    
+    //culling statistics for this cloud
+    unsigned long long voiceFrames, skippedFrames;
     
     //number of grains in this cluster
     unsigned int numVoices;
 
     //cluster params
     float overlap, overlapNorm, pitch, duration,pitchLFOFreq, pitchLFOAmount;
-    int myDirMode, windowType;
+    int densityMode;
+    float grainRate;
+    int myDirMode, windowType, interpQuality;
     
     //audio files
     vector<AudioFile *> *theSounds;
@@ -196,13 +280,15 @@ public:
     //destructor
     ~GrainClusterVis();
     
-    //constructor (takes center position (x,y), number of voices, sound rectangles)
-    GrainClusterVis(float x, float y, unsigned int numVoices,vector<SoundRect*>*rects);
+    //constructor (takes center position (x,y), number of voices, sound rectangles
+    //and their spatial index - NULL searches every rectangle)
+    GrainClusterVis(float x, float y, unsigned int numVoices,vector<SoundRect*>*rects,RectGrid * grid);
     
     //render
     void draw();
-    //get playback position in registered rectangles and return to grain cloud
-    void getTriggerPos(unsigned int idx, double * playPos, double * playVols,float dur);
+    //move grain idx and return the sounds under it (at most maxHits - the
+    //quietest are left out) in theHits
+    unsigned int getTriggerPos(unsigned int idx, GrainHit * theHits, unsigned int maxHits, float dur);
     //move grains
     void updateCloudPosition(float x, float y);
     void updateGrainPosition(int idx, float x, float y);
@@ -230,6 +316,14 @@ public:
     //set the pulse duration (which determines the frequency of the pulse)
     void setDuration(float dur);
     
+    //spatial index of the rectangles
+    RectGrid * getRectGrid();
+    
+    //rectangles we may read, when the ui thread appends to them while the
+    //cloud plays (see GrainVoiceBank::setSoundCount).  NULL = all
+    void setSoundCount(const std::atomic<unsigned int> * theCount);
+    const std::atomic<unsigned int> * getSoundCount();
+    
 protected:
 private:
     bool isOn,isSelected;
@@ -248,6 +342,8 @@ private:
     vector<GrainVis*> * myGrainsV;
     //registered sound rectangles 
     vector<SoundRect*> * theLandscape;
+    RectGrid * rectGrid;
+    const std::atomic<unsigned int> * soundCount;
 };
 
 
@@ -0,0 +1,215 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  GrainInterp.h
+//  Borderlands
+//
+//  Sample interpolators used by the grain source kernels (chosen per cloud):
+//  2 point linear, 4 point cubic Hermite and 8/16 tap polyphase windowed
+//  sinc.  Each reads BEFORE frames before and AFTER frames after the
+//  playhead frame, and has a scalar and a vector (GrainSimd) form.  Both
+//  get the playhead phase and its fraction (nu); the polynomial forms use
+//  the fraction, the sinc uses the phase to pick its row, so each leaves
+//  the other unnamed.
+//
+
+
+#ifndef GRAININTERP_H
+#define GRAININTERP_H
+
+#include "theglobals.h"
+#include "GrainSimd.h"
+#include <math.h>
+
+//interpolation quality
+enum {INTERP_LINEAR, INTERP_CUBIC, INTERP_SINC8, INTERP_SINC16, NUM_INTERP};
+
+//sinc table resolution: 2^GRAIN_SINC_PHASE_BITS phases per frame (plus the end point)
+#define GRAIN_SINC_PHASE_BITS 8
+#define GRAIN_SINC_PHASES (1 << GRAIN_SINC_PHASE_BITS)
+
+
+//-----------------------------------------------------------------------------
+// Polyphase windowed sinc coefficients, TAPS per phase, built on first use.
+// Row k holds the taps for a fraction of k / GRAIN_SINC_PHASES; each row is
+// normalized to unity gain at DC.
+//-----------------------------------------------------------------------------
+template <typename T, int TAPS>
+const T * grainSincTable()
+{
+    static T * table = NULL;
+    if (table == NULL){
+        T * coefs = new T[(GRAIN_SINC_PHASES + 1) * TAPS];
+        const double half = TAPS / 2;
+        //cutoff a little under nyquist so the short kernels still stop well
+        const double cutoff = (TAPS >= 16) ? 0.95 : 0.9;
+        for (int k = 0; k <= GRAIN_SINC_PHASES; k++){
+            double frac = (double) k / (double) GRAIN_SINC_PHASES;
+            double sum = 0.0;
+            double h[TAPS];
+            for (int t = 0; t < TAPS; t++){
+                //distance from tap to the read position
+                double d = (double) (t - (TAPS/2 - 1)) - frac;
+                double x = M_PI * cutoff * d;
+                double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(x) / x;
+                //blackman window over the kernel span
+                double w = 0.42 + 0.5 * cos(M_PI * d / half) + 0.08 * cos(2.0 * M_PI * d / half);
+                if (fabs(d) >= half)
+                    w = 0.0;
+                h[t] = sinc * w;
+                sum += h[t];
+            }
+            for (int t = 0; t < TAPS; t++)
+                coefs[k*TAPS + t] = (T) (h[t] / sum);
+        }
+        table = coefs;
+    }
+    return table;
+}
+
+
+//-----------------------------------------------------------------------------
+// Linear (2 point) - same arithmetic as the original per-frame code
+//-----------------------------------------------------------------------------
+template <typename T>
+struct GrainLinear
+{
+    enum { BEFORE = 0, AFTER = 1 };
+    typedef GrainSimd<T> S;
+
+    //a points at the playhead frame, stride = channels
+    inline T scalar(const T * a, int stride, GrainPhase, T nu) const
+    {
+        return ((T) 1.0 - nu) * a[0] + nu * a[stride];
+    }
+
+    inline typename S::V vec(const T * w, const typename S::I & idx, int stride,
+                             const typename S::P &, typename S::V nu) const
+    {
+        typename S::V a = S::gather(w, idx, stride);
+        typename S::V b = S::gather(w + stride, idx, stride);
+        return S::add(S::mul(S::sub(S::set1((T) 1.0), nu), a), S::mul(nu, b));
+    }
+};
+
+
+//-----------------------------------------------------------------------------
+// Cubic Hermite (4 point, Catmull-Rom tangents)
+//-----------------------------------------------------------------------------
+template <typename T>
+struct GrainCubic
+{
+    enum { BEFORE = 1, AFTER = 2 };
+    typedef GrainSimd<T> S;
+
+    inline T scalar(const T * a, int stride, GrainPhase, T nu) const
+    {
+        T y0 = a[-stride], y1 = a[0], y2 = a[stride], y3 = a[2*stride];
+        T c1 = (T) 0.5 * (y2 - y0);
+        T c2 = y0 - (T) 2.5 * y1 + (T) 2.0 * y2 - (T) 0.5 * y3;
+        T c3 = (T) 0.5 * (y3 - y0) + (T) 1.5 * (y1 - y2);
+        return ((c3 * nu + c2) * nu + c1) * nu + y1;
+    }
+
+    inline typename S::V vec(const T * w, const typename S::I & idx, int stride,
+                             const typename S::P &, typename S::V nu) const
+    {
+        typename S::V y0 = S::gather(w - stride, idx, stride);
+        typename S::V y1 = S::gather(w, idx, stride);
+        typename S::V y2 = S::gather(w + stride, idx, stride);
+        typename S::V y3 = S::gather(w + 2*stride, idx, stride);
+        typename S::V c1 = S::mul(S::set1((T) 0.5), S::sub(y2, y0));
+        typename S::V c2 = S::sub(S::add(S::sub(y0, S::mul(S::set1((T) 2.5), y1)), S::mul(S::set1((T) 2.0), y2)),
+                                  S::mul(S::set1((T) 0.5), y3));
+        typename S::V c3 = S::add(S::mul(S::set1((T) 0.5), S::sub(y3, y0)), S::mul(S::set1((T) 1.5), S::sub(y1, y2)));
+        return S::add(S::mul(S::add(S::mul(S::add(S::mul(c3, nu), c2), nu), c1), nu), y1);
+    }
+};
+
+
+//-----------------------------------------------------------------------------
+// Polyphase windowed sinc (TAPS points, nearest table phase)
+//-----------------------------------------------------------------------------
+template <typename T, int TAPS>
+struct GrainSinc
+{
+    enum { BEFORE = TAPS/2 - 1, AFTER = TAPS/2 };
+    typedef GrainSimd<T> S;
+
+    const T * coefs;
+
+    GrainSinc() : coefs(grainSincTable<T, TAPS>()) {}
+
+    inline T scalar(const T * a, int stride, GrainPhase p, T) const
+    {
+        const T * h = coefs + grainPhaseStep(p, GRAIN_SINC_PHASE_BITS) * TAPS;
+        const T * x = a - BEFORE*stride;
+        T sum = 0;
+        for (int t = 0; t < TAPS; t++)
+            sum += h[t] * x[t*stride];
+        return sum;
+    }
+
+    inline typename S::V vec(const T * w, const typename S::I & idx, int stride,
+                             const typename S::P & p, typename S::V) const
+    {
+        const typename S::I row = S::step(p, GRAIN_SINC_PHASE_BITS);
+        const T * x = w - BEFORE*stride;
+        typename S::V sum = S::set1((T) 0.0);
+        for (int t = 0; t < TAPS; t++)
+            sum = S::add(sum, S::mul(S::gather(coefs + t, row, TAPS), S::gather(x + t*stride, idx, stride)));
+        return sum;
+    }
+};
+
+
+//frames read before/after the playhead frame for a quality setting
+static inline int grainInterpBefore(int quality)
+{
+    switch (quality) {
+        case INTERP_CUBIC: return GrainCubic<SAMPLE>::BEFORE;
+        case INTERP_SINC8: return GrainSinc<SAMPLE, 8>::BEFORE;
+        case INTERP_SINC16: return GrainSinc<SAMPLE, 16>::BEFORE;
+        default: return GrainLinear<SAMPLE>::BEFORE;
+    }
+}
+
+static inline int grainInterpAfter(int quality)
+{
+    switch (quality) {
+        case INTERP_CUBIC: return GrainCubic<SAMPLE>::AFTER;
+        case INTERP_SINC8: return GrainSinc<SAMPLE, 8>::AFTER;
+        case INTERP_SINC16: return GrainSinc<SAMPLE, 16>::AFTER;
+        default: return GrainLinear<SAMPLE>::AFTER;
+    }
+}
+
+//build tables ahead of time (keeps the first sinc grain off the slow path)
+static inline void grainInterpInit()
+{
+    grainSincTable<SAMPLE, 8>();
+    grainSincTable<SAMPLE, 16>();
+}
+
+
+#endif
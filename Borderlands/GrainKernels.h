@@ -0,0 +1,374 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  GrainKernels.h
+//  Borderlands
+//
+//  Block rendering kernels for grain voices.  Each kernel works on a short
+//  run of frames (at most GRAIN_BLOCK) and processes GrainSimd<T>::W frames
+//  per step (see GrainSimd.h), with a plain scalar fallback for other
+//  targets and for the tail of each run.  Kernels are templated on the
+//  sample type T (SAMPLE, see theglobals.h).  Source kernels are specialized
+//  at compile time for each (file channels, output channels) pair, so the
+//  inner loops carry no channel branches.
+//
+//  Runs are accumulated planar: output channel k of frame i lives at
+//  acc[k*GRAIN_BLOCK + i].  grainPan adds a voice's run to its cloud's
+//  (planar) bus, and grainMixBus interleaves the bus into the output.
+//
+
+
+#ifndef GRAINKERNELS_H
+#define GRAINKERNELS_H
+
+#include "theglobals.h"
+#include "GrainSimd.h"
+#include "GrainInterp.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//frames rendered per kernel call (voices chop sub buffers into runs of this size)
+#define GRAIN_BLOCK 64
+
+//alignment for scratch buffers
+#define GRAIN_ALIGN __attribute__((aligned(32)))
+
+
+//-----------------------------------------------------------------------------
+// Cache line aligned, zeroed allocation for parallel voice arrays
+//-----------------------------------------------------------------------------
+static inline void * grainAlloc(size_t bytes)
+{
+    void * mem = NULL;
+    if (bytes == 0)
+        bytes = 1;
+    if (posix_memalign(&mem, 64, bytes) != 0)
+        return NULL;
+    memset(mem, 0, bytes);
+    return mem;
+}
+
+static inline void grainFree(void * mem)
+{
+    free(mem);
+}
+
+
+//-----------------------------------------------------------------------------
+// Linear interpolation helper (same arithmetic as the original per-frame code)
+//-----------------------------------------------------------------------------
+template <typename T>
+static inline T grainLerp(const T * buf, unsigned long idx, T nu)
+{
+    return ((T) 1.0 - nu) * buf[idx] + nu * buf[idx + 1];
+}
+
+
+//-----------------------------------------------------------------------------
+// Frames (at most n) left before a window reader starting at reader passes
+// the end of the window table
+//-----------------------------------------------------------------------------
+static inline int grainWindowFrames(GrainPhase reader, GrainPhase inc, int n)
+{
+    const GrainPhase end = grainPhaseFrames(WINDOW_LEN - 1);
+    if (reader > end)
+        return 0;
+    GrainPhase live = (end - reader) / inc + 1;
+    return (live < n) ? (int) live : n;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frames (at most n) a source starting at pos and moving by inc per frame
+// stays playable by an interpolator reading before frames before and after
+// frames after the playhead frame: before < position < frames - 1 - after
+// (0 < position < frames - 2 for linear).  Positions are monotonic, so the
+// span is solved once from the start position and direction (exactly,
+// since phases are integers).
+//-----------------------------------------------------------------------------
+static inline int grainSourceSpan(GrainPhase pos, GrainPhase inc, unsigned long frames, int n,
+                                  int before, int after)
+{
+    if (frames < (unsigned long) (before + after + 3))
+        return 0;
+    const GrainPhase low = grainPhaseFrames(before);
+    const GrainPhase limit = grainPhaseFrames(frames - 1 - after);
+    if ((pos <= low) || (pos >= limit))
+        return 0;
+
+    //frames until the boundary in the direction of travel
+    GrainPhase room;
+    if (inc > 0)
+        room = (limit - pos + inc - 1) / inc;
+    else if (inc < 0)
+        room = (pos - low - inc - 1) / -inc;
+    else
+        room = n;
+
+    return (room < n) ? (int) room : n;
+}
+
+
+//-----------------------------------------------------------------------------
+// Window envelope: env[i] = window(reader + i*inc), linearly interpolated.
+// reader must be >= 0.
+//-----------------------------------------------------------------------------
+template <typename T>
+static inline void grainEnvelope(const T * window, GrainPhase reader, GrainPhase inc, T * env, int n)
+{
+    int i = 0;
+#if defined(GRAIN_USE_SIMD)
+    typedef GrainSimd<T> S;
+    typename S::P p = S::ramp(reader, inc);
+    const typename S::V one = S::set1((T) 1.0);
+    for (; i + S::W <= n; i += S::W){
+        typename S::I idx;
+        typename S::V nu;
+        S::split(p, idx, nu);
+        typename S::V a = S::gather(window, idx, 1);
+        typename S::V b = S::gather(window + 1, idx, 1);
+        S::store(env + i, S::add(S::mul(S::sub(one, nu), a), S::mul(nu, b)));
+        p = S::advance(p, S::W * inc);
+    }
+    reader += i * inc;
+#endif
+    for (; i < n; i++){
+        env[i] = grainLerp(window, (unsigned long) grainPhaseIndex(reader), (T) grainPhaseFrac(reader));
+        reader += inc;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Source kernels.  One kernel per (source channels, output channels,
+// interpolator) triple accumulates a file into the planar OUT_CH wide
+// scratch buffer:
+//     acc[k*GRAIN_BLOCK + i] += interp(wave, pos + i*inc)[channel] * env[i] * atten
+// Sources with fewer channels than the output wrap around (output k plays
+// source channel k % SRC_CH - mono goes everywhere, stereo alternates L/R).
+// Sources with more channels are folded down (source channel c goes to
+// output c % OUT_CH, scaled by the number of channels sharing that output).
+// Caller guarantees every position in the run leaves room for the
+// interpolator (see grainSourceSpan).  The channel count argument is only
+// used by the generic N channel kernel.
+//-----------------------------------------------------------------------------
+typedef void (*GrainSourceKernel)(const SAMPLE * wave, unsigned int channels, GrainPhase pos, GrainPhase inc,
+                                  SAMPLE atten, const SAMPLE * env, SAMPLE * acc, int n);
+
+//gain applied to source channel c when SRC channels fold into OUT outputs
+static inline double grainFoldGain(unsigned int src, unsigned int out, unsigned int c)
+{
+    if (src <= out)
+        return 1.0;
+    const unsigned int k = c % out;
+    return (double) 1.0 / (double) ((src - k + out - 1) / out);
+}
+
+template <typename T, int SRC_CH, int OUT_CH, typename INTERP>
+struct GrainSource
+{
+    //the channel count is SRC_CH here - the argument only matters to the
+    //generic kernel below
+    static void render(const T * wave, unsigned int, GrainPhase pos, GrainPhase inc,
+                       T atten, const T * env, T * acc, int n)
+    {
+        const INTERP interp;
+        int i = 0;
+#if defined(GRAIN_USE_SIMD)
+        typedef GrainSimd<T> S;
+        typename S::P p = S::ramp(pos, inc);
+        const typename S::V vatt = S::set1(atten);
+        for (; i + S::W <= n; i += S::W){
+            typename S::I idx;
+            typename S::V nu;
+            S::split(p, idx, nu);
+            const typename S::V e = S::load(env + i);
+            typename S::V s[SRC_CH];
+            for (int c = 0; c < SRC_CH; c++)
+                s[c] = S::mul(S::mul(interp.vec(wave + c, idx, SRC_CH, p, nu), e), vatt);
+            if (SRC_CH <= OUT_CH){
+                for (int k = 0; k < OUT_CH; k++){
+                    T * o = acc + k*GRAIN_BLOCK + i;
+                    S::store(o, S::add(S::load(o), s[k % SRC_CH]));
+                }
+            }else{
+                for (int c = 0; c < SRC_CH; c++){
+                    T * o = acc + (c % OUT_CH)*GRAIN_BLOCK + i;
+                    S::store(o, S::add(S::load(o), S::mul(s[c], S::set1((T) grainFoldGain(SRC_CH, OUT_CH, c)))));
+                }
+            }
+            p = S::advance(p, S::W * inc);
+        }
+        pos += i * inc;
+#endif
+        for (; i < n; i++){
+            T nu = (T) grainPhaseFrac(pos);
+            const T * a = wave + (unsigned long) grainPhaseIndex(pos) * SRC_CH;
+            if (SRC_CH <= OUT_CH){
+                T s[SRC_CH];
+                for (int c = 0; c < SRC_CH; c++)
+                    s[c] = interp.scalar(a + c, SRC_CH, pos, nu) * env[i] * atten;
+                for (int k = 0; k < OUT_CH; k++)
+                    acc[k*GRAIN_BLOCK + i] += s[k % SRC_CH];
+            }else{
+                for (int c = 0; c < SRC_CH; c++)
+                    acc[(c % OUT_CH)*GRAIN_BLOCK + i] += interp.scalar(a + c, SRC_CH, pos, nu) * env[i] * atten
+                                                         * (T) grainFoldGain(SRC_CH, OUT_CH, c);
+            }
+            pos += inc;
+        }
+    }
+};
+
+//any number of source channels (files wider than the specialized set)
+template <typename T, int OUT_CH, typename INTERP>
+struct GrainSourceN
+{
+    static void render(const T * wave, unsigned int channels, GrainPhase pos, GrainPhase inc,
+                       T atten, const T * env, T * acc, int n)
+    {
+        const INTERP interp;
+        int i = 0;
+#if defined(GRAIN_USE_SIMD)
+        typedef GrainSimd<T> S;
+        typename S::P p = S::ramp(pos, inc);
+        const typename S::V vatt = S::set1(atten);
+        for (; i + S::W <= n; i += S::W){
+            typename S::I idx;
+            typename S::V nu;
+            S::split(p, idx, nu);
+            const typename S::V e = S::load(env + i);
+            for (unsigned int c = 0; c < channels; c++){
+                typename S::V v = S::mul(S::mul(interp.vec(wave + c, idx, channels, p, nu), e), vatt);
+                T * o = acc + (c % OUT_CH)*GRAIN_BLOCK + i;
+                S::store(o, S::add(S::load(o), S::mul(v, S::set1((T) grainFoldGain(channels, OUT_CH, c)))));
+            }
+            p = S::advance(p, S::W * inc);
+        }
+        pos += i * inc;
+#endif
+        for (; i < n; i++){
+            T nu = (T) grainPhaseFrac(pos);
+            const T * a = wave + (unsigned long) grainPhaseIndex(pos) * channels;
+            for (unsigned int c = 0; c < channels; c++)
+                acc[(c % OUT_CH)*GRAIN_BLOCK + i] += interp.scalar(a + c, channels, pos, nu) * env[i] * atten
+                                                     * (T) grainFoldGain(channels, OUT_CH, c);
+            pos += inc;
+        }
+    }
+};
+
+
+//-----------------------------------------------------------------------------
+// Pick the kernel for a file with the given number of channels and the
+// interpolation quality (done once, when the grain is triggered)
+//-----------------------------------------------------------------------------
+template <typename INTERP>
+static inline GrainSourceKernel grainSourceKernelFor(unsigned int channels)
+{
+    switch (channels) {
+        case 1: return &GrainSource<SAMPLE, 1, MY_CHANNELS, INTERP>::render;
+        case 2: return &GrainSource<SAMPLE, 2, MY_CHANNELS, INTERP>::render;
+        case 3: return &GrainSource<SAMPLE, 3, MY_CHANNELS, INTERP>::render;
+        case 4: return &GrainSource<SAMPLE, 4, MY_CHANNELS, INTERP>::render;
+        case 5: return &GrainSource<SAMPLE, 5, MY_CHANNELS, INTERP>::render;
+        case 6: return &GrainSource<SAMPLE, 6, MY_CHANNELS, INTERP>::render;
+        case 7: return &GrainSource<SAMPLE, 7, MY_CHANNELS, INTERP>::render;
+        case 8: return &GrainSource<SAMPLE, 8, MY_CHANNELS, INTERP>::render;
+        default: return &GrainSourceN<SAMPLE, MY_CHANNELS, INTERP>::render;
+    }
+}
+
+static inline GrainSourceKernel grainSourceKernel(unsigned int channels, int quality)
+{
+    switch (quality) {
+        case INTERP_CUBIC: return grainSourceKernelFor< GrainCubic<SAMPLE> >(channels);
+        case INTERP_SINC8: return grainSourceKernelFor< GrainSinc<SAMPLE, 8> >(channels);
+        case INTERP_SINC16: return grainSourceKernelFor< GrainSinc<SAMPLE, 16> >(channels);
+        default: return grainSourceKernelFor< GrainLinear<SAMPLE> >(channels);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Pan a rendered (planar) run into a cloud bus (planar, busFrames apart):
+// bus[k*busFrames + i] += acc[k*GRAIN_BLOCK + i] * chanGains[k].  Silent
+// channels (STEREO / AROUND spatialization) are skipped.
+//-----------------------------------------------------------------------------
+template <typename T>
+static inline void grainPan(const T * acc, const T * chanGains, T * bus, unsigned long busFrames, int n)
+{
+    for (int k = 0; k < MY_CHANNELS; k++){
+        const T g = chanGains[k];
+        if (g == 0)
+            continue;
+        const T * a = acc + k*GRAIN_BLOCK;
+        T * o = bus + k*busFrames;
+        int i = 0;
+#if defined(GRAIN_USE_SIMD)
+        typedef GrainSimd<T> S;
+        const typename S::V vg = S::set1(g);
+        for (; i + S::W <= n; i += S::W)
+            S::store(o + i, S::add(S::load(o + i), S::mul(S::load(a + i), vg)));
+#endif
+        for (; i < n; i++)
+            o[i] += a[i] * g;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Mix a cloud bus into the interleaved output buffer:
+// out[i*MY_CHANNELS + k] += bus[k*busFrames + i] * gain.  The gain ramps
+// from gain0 to gain1 across the buffer when they differ.  No clipping here
+// - the master limiter handles the summed output.
+//-----------------------------------------------------------------------------
+template <typename T>
+static inline void grainMixBus(const T * bus, unsigned long busFrames, double gain0, double gain1, T * out, int n)
+{
+    int i = 0;
+#if defined(GRAIN_USE_SIMD) && (MY_CHANNELS == 2)
+    if (gain0 == gain1){
+        typedef GrainSimd<T> S;
+        const typename S::V vgain = S::set1((T) gain1);
+        for (; i + S::W <= n; i += S::W){
+            typename S::V l = S::mul(S::load(bus + i), vgain);
+            typename S::V r = S::mul(S::load(bus + busFrames + i), vgain);
+            typename S::V a, b;
+            S::interleave(l, r, a, b);
+            T * o = out + 2*i;
+            S::store(o, S::add(S::load(o), a));
+            S::store(o + S::W, S::add(S::load(o + S::W), b));
+        }
+    }
+#endif
+    const double step = (n > 0) ? (gain1 - gain0) / (double) n : 0.0;
+    for (; i < n; i++){
+        const T g = (T) (gain0 + step * (double) (i + 1));
+        for (int k = 0; k < MY_CHANNELS; k++)
+            out[i*MY_CHANNELS + k] += bus[k*busFrames + i] * g;
+    }
+}
+
+
+#endif
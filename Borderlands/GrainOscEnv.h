@@ -0,0 +1,193 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  GrainOscEnv.h
+//  Borderlands
+//
+//  Analytic grain envelopes.  Hann, Tukey, Gaussian and exponential windows
+//  are computed straight from the window reader position instead of being
+//  read out of the Window tables, so there is no table traffic and grains
+//  much longer or shorter than WINDOW_LEN see the exact curve rather than
+//  a linear interpolation of it.
+//
+//  Envelopes are computed for one grain at a time, vectorised along that
+//  grain's frames - not batched across voices - so each envelope comes out
+//  contiguous for the source kernels.  A run is seeded exactly at its first
+//  frames and then stepped W frames (the GrainSimd width) at a time with a
+//  recurrence (cosine oscillator or constant ratio), so no error carries
+//  from run to run.  Positions are in window table frames (0 .. WINDOW_LEN),
+//  the same units as the table reader, and the curves match the tables at
+//  every frame.
+//
+
+
+#ifndef GRAINOSCENV_H
+#define GRAINOSCENV_H
+
+#include "theglobals.h"
+#include "GrainKernels.h"
+#include "Window.h"
+#include <math.h>
+
+
+//shapes that have an analytic form
+static inline bool grainOscSupported(int type)
+{
+    switch (type) {
+        case HANNING:
+        case EXPDEC:
+        case REXPDEC:
+        case GAUSSIAN:
+        case TUKEY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// out[i] = a + b * cos(w * (t0 + i*dt)) for i < n (written in whole rows of
+// W, so out needs room for n rounded up to W).  Two rows are seeded, the
+// rest follow c[i+W] = 2cos(wWdt) c[i] - c[i-W].
+//-----------------------------------------------------------------------------
+static inline void grainOscCosine(double a, double b, double w, double t0, double dt, double * out, int n)
+{
+    typedef GrainSimd<double> S;
+    double seed[2*S::W];
+    for (int l = 0; l < 2*S::W; l++)
+        seed[l] = cos(w * (t0 + l*dt));
+
+    const S::V va = S::set1(a);
+    const S::V vb = S::set1(b);
+    const S::V k = S::set1(2.0 * cos(w * S::W * dt));
+    S::V prev = S::load(seed);
+    S::V cur = S::load(seed + S::W);
+    S::store(out, S::add(va, S::mul(vb, prev)));
+    for (int i = S::W; i < n; i += S::W){
+        S::store(out + i, S::add(va, S::mul(vb, cur)));
+        S::V next = S::sub(S::mul(k, cur), prev);
+        prev = cur;
+        cur = next;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// out[i] = exp(s * (t0 + i*dt) + c) - one row seeded, then a constant ratio
+//-----------------------------------------------------------------------------
+static inline void grainOscExp(double s, double c, double t0, double dt, double * out, int n)
+{
+    typedef GrainSimd<double> S;
+    double seed[S::W];
+    for (int l = 0; l < S::W; l++)
+        seed[l] = exp(s * (t0 + l*dt) + c);
+
+    const S::V r = S::set1(exp(s * S::W * dt));
+    S::V g = S::load(seed);
+    for (int i = 0; i < n; i += S::W){
+        S::store(out + i, g);
+        g = S::mul(g, r);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// out[i] = exp(-beta * (t0 + i*dt - m)^2).  The ratio between frames W apart
+// itself changes by a constant factor, so one row of values and one row of
+// ratios are seeded.
+//-----------------------------------------------------------------------------
+static inline void grainOscGauss(double beta, double m, double t0, double dt, double * out, int n)
+{
+    typedef GrainSimd<double> S;
+    const double D = S::W * dt;
+    double seed[S::W];
+    double ratio[S::W];
+    for (int l = 0; l < S::W; l++){
+        double u = t0 + l*dt - m;
+        seed[l] = exp(-beta * u * u);
+        ratio[l] = exp(-beta * (2.0 * u * D + D * D));
+    }
+
+    const S::V rr = S::set1(exp(-2.0 * beta * D * D));
+    S::V g = S::load(seed);
+    S::V q = S::load(ratio);
+    for (int i = 0; i < n; i += S::W){
+        S::store(out + i, g);
+        g = S::mul(g, q);
+        q = S::mul(q, rr);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Envelope for n frames of a window of the given type starting at reader
+// (same positions as grainEnvelope reading the Window table)
+//-----------------------------------------------------------------------------
+static inline void grainOscEnvelope(int type, GrainPhase reader, GrainPhase inc, SAMPLE * env, int n)
+{
+    double work[GRAIN_BLOCK + GrainSimd<double>::W];
+    const double len = (double) WINDOW_LEN;
+    const double t0 = grainPhaseToDouble(reader);
+    const double dt = grainPhaseToDouble(inc);
+
+    switch (type) {
+        case HANNING:
+            grainOscCosine(0.5, -0.5, 2.0 * M_PI / len, t0, dt, work, n);
+            break;
+        case TUKEY:{
+            //both tapers are the same cosine as long as 1/TUKEY_ALPHA is a whole number
+            const double edge = TUKEY_ALPHA * 0.5 * len;
+            grainOscCosine(0.5, -0.5, 2.0 * M_PI / (TUKEY_ALPHA * len), t0, dt, work, n);
+            for (int i = 0; i < n; i++){
+                double t = t0 + i*dt;
+                if ((t >= edge) && (t <= len - edge))
+                    work[i] = 1.0;
+            }
+            break;
+        }
+        case GAUSSIAN:{
+            const double sigma = GAUSSIAN_SIGMA * len;
+            grainOscGauss(0.5 / (sigma * sigma), 0.5 * len, t0, dt, work, n);
+            break;
+        }
+        case EXPDEC:
+            grainOscExp(-1.0 / EXPDEC_TAU, 0.0, t0, dt, work, n);
+            break;
+        case REXPDEC:
+            //mirror of EXPDEC: table frame i holds EXPDEC frame WINDOW_LEN - 1 - i
+            grainOscExp(1.0 / EXPDEC_TAU, -(len - 1.0) / EXPDEC_TAU, t0, dt, work, n);
+            break;
+        default:
+            for (int i = 0; i < n; i++)
+                work[i] = 1.0;
+            break;
+    }
+
+    for (int i = 0; i < n; i++)
+        env[i] = (SAMPLE) work[i];
+}
+
+
+#endif
@@ -0,0 +1,392 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  GrainSimd.h
+//  Borderlands
+//
+//  Thin wrappers over the vector unit used by the grain kernels, templated
+//  on the sample type.  GrainSimd<T> handles W frames per step:
+//
+//      AVX2:  double W = 4 (one __m256d),      float W = 8 (one __m256)
+//      SSE2:  double W = 4 (two __m128d),      float W = 4 (one __m128)
+//      other: W = 1 (plain scalar code)
+//
+//  V holds W samples, P holds W playback positions and I holds W frame
+//  indices.  Positions are 32.32 fixed point phases (GrainPhase): the frame
+//  index is the top half and the interpolation fraction the bottom half, so
+//  no floor() is needed, forward and reverse playback drift identically and
+//  long files keep their precision in float mode.  Files are limited to
+//  2^31 frames.
+//
+
+
+#ifndef GRAINSIMD_H
+#define GRAINSIMD_H
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GRAIN_USE_AVX2 1
+#define GRAIN_USE_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GRAIN_USE_SSE2 1
+#define GRAIN_USE_SIMD 1
+#endif
+
+
+//-----------------------------------------------------------------------------
+// 32.32 fixed point phase
+//-----------------------------------------------------------------------------
+typedef long long GrainPhase;
+
+#define GRAIN_PHASE_ONE 4294967296.0
+#define GRAIN_PHASE_FRAC_MASK 0xFFFFFFFFLL
+
+//round to the nearest phase step (symmetric, so +inc and -inc match)
+static inline GrainPhase grainPhase(double x)
+{
+    if (x < 0)
+        return -(GrainPhase) (-x * GRAIN_PHASE_ONE + 0.5);
+    return (GrainPhase) (x * GRAIN_PHASE_ONE + 0.5);
+}
+
+static inline GrainPhase grainPhaseFrames(long long frames)
+{
+    return (GrainPhase) (frames << 32);
+}
+
+static inline double grainPhaseToDouble(GrainPhase p)
+{
+    return (double) p * ((double) 1.0 / GRAIN_PHASE_ONE);
+}
+
+//phase must be >= 0
+static inline long grainPhaseIndex(GrainPhase p)
+{
+    return (long) (p >> 32);
+}
+
+static inline double grainPhaseFrac(GrainPhase p)
+{
+    return (double) (p & GRAIN_PHASE_FRAC_MASK) * ((double) 1.0 / GRAIN_PHASE_ONE);
+}
+
+//fraction rounded to the nearest of 2^bits steps (0 .. 2^bits), for table lookups
+static inline long grainPhaseStep(GrainPhase p, int bits)
+{
+    return (long) (((p & GRAIN_PHASE_FRAC_MASK) + (1LL << (31 - bits))) >> (32 - bits));
+}
+
+
+//-----------------------------------------------------------------------------
+// Scalar fallback (any sample type)
+//-----------------------------------------------------------------------------
+template <typename T>
+struct GrainSimd
+{
+    enum { W = 1 };
+    typedef T V;
+    typedef GrainPhase P;
+    typedef long I;
+
+    static inline V set1(T x) { return x; }
+    static inline V load(const T * p) { return *p; }
+    static inline void store(T * p, V v) { *p = v; }
+    static inline V add(V a, V b) { return a + b; }
+    static inline V sub(V a, V b) { return a - b; }
+    static inline V mul(V a, V b) { return a * b; }
+    static inline V min(V a, V b) { return (a < b) ? a : b; }
+    static inline V max(V a, V b) { return (a > b) ? a : b; }
+    static inline P ramp(GrainPhase pos, GrainPhase inc) { return pos; }
+    static inline P advance(P p, GrainPhase step) { return p + step; }
+    static inline void split(P p, I & idx, V & frac) { idx = grainPhaseIndex(p); frac = (T) grainPhaseFrac(p); }
+    static inline I step(P p, int bits) { return grainPhaseStep(p, bits); }
+    static inline V gather(const T * base, I idx, int stride) { return base[idx * stride]; }
+};
+
+
+#if defined(GRAIN_USE_AVX2)
+
+//-----------------------------------------------------------------------------
+// AVX2 (64 bit phase lanes, 64 bit index gathers)
+//-----------------------------------------------------------------------------
+
+//4 phases -> frame indices (64 bit lanes) and fractions
+static inline void grainAvx2Split(__m256i p, __m256i & idx, __m256d & frac)
+{
+    idx = _mm256_srli_epi64(p, 32);
+    //low 32 bits into the mantissa of 2^52, minus 2^52 = exact double
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+    __m256i lo = _mm256_and_si256(p, _mm256_set1_epi64x(GRAIN_PHASE_FRAC_MASK));
+    __m256d f = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(lo, magic)), _mm256_castsi256_pd(magic));
+    frac = _mm256_mul_pd(f, _mm256_set1_pd((double) 1.0 / GRAIN_PHASE_ONE));
+}
+
+//4 phases -> fractions rounded to 2^bits steps (see grainPhaseStep)
+static inline __m256i grainAvx2Step(__m256i p, int bits)
+{
+    __m256i f = _mm256_and_si256(p, _mm256_set1_epi64x(GRAIN_PHASE_FRAC_MASK));
+    f = _mm256_add_epi64(f, _mm256_set1_epi64x(1LL << (31 - bits)));
+    return _mm256_srli_epi64(f, 32 - bits);
+}
+
+static inline __m256i grainAvx2Ramp(GrainPhase pos, GrainPhase inc)
+{
+    return _mm256_set_epi64x(pos + 3*inc, pos + 2*inc, pos + inc, pos);
+}
+
+static inline __m256i grainAvx2Stride(__m256i idx, int stride)
+{
+    if (stride != 1)
+        idx = _mm256_mul_epu32(idx, _mm256_set1_epi64x(stride));
+    return idx;
+}
+
+template <>
+struct GrainSimd<double>
+{
+    enum { W = 4 };
+    typedef __m256d V;
+    typedef __m256i P;
+    typedef __m256i I;
+
+    static inline V set1(double x) { return _mm256_set1_pd(x); }
+    static inline V load(const double * p) { return _mm256_loadu_pd(p); }
+    static inline void store(double * p, V v) { _mm256_storeu_pd(p, v); }
+    static inline V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static inline V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static inline V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static inline V min(V a, V b) { return _mm256_min_pd(a, b); }
+    static inline V max(V a, V b) { return _mm256_max_pd(a, b); }
+    static inline P ramp(GrainPhase pos, GrainPhase inc) { return grainAvx2Ramp(pos, inc); }
+    static inline P advance(P p, GrainPhase step) { return _mm256_add_epi64(p, _mm256_set1_epi64x(step)); }
+    static inline void split(P p, I & idx, V & frac) { grainAvx2Split(p, idx, frac); }
+    static inline I step(P p, int bits) { return grainAvx2Step(p, bits); }
+    static inline V gather(const double * base, I idx, int stride)
+    {
+        return _mm256_i64gather_pd(base, grainAvx2Stride(idx, stride), 8);
+    }
+    //(l0 l1 l2 l3),(r0 r1 r2 r3) -> (l0 r0 l1 r1),(l2 r2 l3 r3)
+    static inline void interleave(V l, V r, V & lo, V & hi)
+    {
+        __m256d a = _mm256_unpacklo_pd(l, r);
+        __m256d b = _mm256_unpackhi_pd(l, r);
+        lo = _mm256_permute2f128_pd(a, b, 0x20);
+        hi = _mm256_permute2f128_pd(a, b, 0x31);
+    }
+};
+
+template <>
+struct GrainSimd<float>
+{
+    enum { W = 8 };
+    typedef __m256 V;
+    struct P { __m256i lo, hi; };
+    struct I { __m256i lo, hi; };
+
+    static inline V set1(float x) { return _mm256_set1_ps(x); }
+    static inline V load(const float * p) { return _mm256_loadu_ps(p); }
+    static inline void store(float * p, V v) { _mm256_storeu_ps(p, v); }
+    static inline V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static inline V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static inline V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static inline V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static inline V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static inline P ramp(GrainPhase pos, GrainPhase inc)
+    {
+        P p;
+        p.lo = grainAvx2Ramp(pos, inc);
+        p.hi = _mm256_add_epi64(p.lo, _mm256_set1_epi64x(4*inc));
+        return p;
+    }
+    static inline P advance(P p, GrainPhase step)
+    {
+        __m256i s = _mm256_set1_epi64x(step);
+        p.lo = _mm256_add_epi64(p.lo, s);
+        p.hi = _mm256_add_epi64(p.hi, s);
+        return p;
+    }
+    static inline void split(P p, I & idx, V & frac)
+    {
+        __m256d f0, f1;
+        grainAvx2Split(p.lo, idx.lo, f0);
+        grainAvx2Split(p.hi, idx.hi, f1);
+        frac = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(f0)), _mm256_cvtpd_ps(f1), 1);
+    }
+    static inline I step(P p, int bits)
+    {
+        I idx;
+        idx.lo = grainAvx2Step(p.lo, bits);
+        idx.hi = grainAvx2Step(p.hi, bits);
+        return idx;
+    }
+    static inline V gather(const float * base, I idx, int stride)
+    {
+        __m128 a = _mm256_i64gather_ps(base, grainAvx2Stride(idx.lo, stride), 4);
+        __m128 b = _mm256_i64gather_ps(base, grainAvx2Stride(idx.hi, stride), 4);
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(a), b, 1);
+    }
+    //(l0..l7),(r0..r7) -> (l0 r0 .. l3 r3),(l4 r4 .. l7 r7)
+    static inline void interleave(V l, V r, V & lo, V & hi)
+    {
+        __m256 a = _mm256_unpacklo_ps(l, r);
+        __m256 b = _mm256_unpackhi_ps(l, r);
+        lo = _mm256_permute2f128_ps(a, b, 0x20);
+        hi = _mm256_permute2f128_ps(a, b, 0x31);
+    }
+};
+
+#elif defined(GRAIN_USE_SSE2)
+
+//-----------------------------------------------------------------------------
+// SSE2 (no hardware gather - indices are pulled out and loaded one by one)
+//-----------------------------------------------------------------------------
+struct GrainSse2Pair { __m128d a, b; };
+struct GrainSse2Phase { __m128i a, b; };
+struct GrainSse2Index { long k[4]; };
+
+//2 phases -> fractions (exact conversion through the mantissa of 2^52)
+static inline __m128d grainSse2Frac(__m128i p)
+{
+    const __m128i magic = _mm_set1_epi64x(0x4330000000000000LL);
+    __m128i lo = _mm_and_si128(p, _mm_set1_epi64x(GRAIN_PHASE_FRAC_MASK));
+    __m128d f = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(lo, magic)), _mm_castsi128_pd(magic));
+    return _mm_mul_pd(f, _mm_set1_pd((double) 1.0 / GRAIN_PHASE_ONE));
+}
+
+static inline void grainSse2Split(GrainSse2Phase p, GrainSse2Index & idx, __m128d & f0, __m128d & f1)
+{
+    long long k[4] __attribute__((aligned(16)));
+    _mm_store_si128((__m128i *) k, _mm_srli_epi64(p.a, 32));
+    _mm_store_si128((__m128i *) (k + 2), _mm_srli_epi64(p.b, 32));
+    for (int i = 0; i < 4; i++)
+        idx.k[i] = (long) k[i];
+    f0 = grainSse2Frac(p.a);
+    f1 = grainSse2Frac(p.b);
+}
+
+static inline GrainSse2Index grainSse2Step(GrainSse2Phase p, int bits)
+{
+    long long k[4] __attribute__((aligned(16)));
+    _mm_store_si128((__m128i *) k, p.a);
+    _mm_store_si128((__m128i *) (k + 2), p.b);
+    GrainSse2Index idx;
+    for (int i = 0; i < 4; i++)
+        idx.k[i] = grainPhaseStep(k[i], bits);
+    return idx;
+}
+
+static inline GrainSse2Phase grainSse2Ramp(GrainPhase pos, GrainPhase inc)
+{
+    GrainSse2Phase p;
+    p.a = _mm_set_epi64x(pos + inc, pos);
+    p.b = _mm_set_epi64x(pos + 3*inc, pos + 2*inc);
+    return p;
+}
+
+static inline GrainSse2Phase grainSse2Advance(GrainSse2Phase p, GrainPhase step)
+{
+    __m128i s = _mm_set1_epi64x(step);
+    p.a = _mm_add_epi64(p.a, s);
+    p.b = _mm_add_epi64(p.b, s);
+    return p;
+}
+
+template <>
+struct GrainSimd<double>
+{
+    enum { W = 4 };
+    typedef GrainSse2Pair V;
+    typedef GrainSse2Phase P;
+    typedef GrainSse2Index I;
+
+    static inline V set1(double x) { V v; v.a = v.b = _mm_set1_pd(x); return v; }
+    static inline V load(const double * p) { V v; v.a = _mm_loadu_pd(p); v.b = _mm_loadu_pd(p + 2); return v; }
+    static inline void store(double * p, V v) { _mm_storeu_pd(p, v.a); _mm_storeu_pd(p + 2, v.b); }
+    static inline V add(V x, V y) { x.a = _mm_add_pd(x.a, y.a); x.b = _mm_add_pd(x.b, y.b); return x; }
+    static inline V sub(V x, V y) { x.a = _mm_sub_pd(x.a, y.a); x.b = _mm_sub_pd(x.b, y.b); return x; }
+    static inline V mul(V x, V y) { x.a = _mm_mul_pd(x.a, y.a); x.b = _mm_mul_pd(x.b, y.b); return x; }
+    static inline V min(V x, V y) { x.a = _mm_min_pd(x.a, y.a); x.b = _mm_min_pd(x.b, y.b); return x; }
+    static inline V max(V x, V y) { x.a = _mm_max_pd(x.a, y.a); x.b = _mm_max_pd(x.b, y.b); return x; }
+    static inline P ramp(GrainPhase pos, GrainPhase inc) { return grainSse2Ramp(pos, inc); }
+    static inline P advance(P p, GrainPhase step) { return grainSse2Advance(p, step); }
+    static inline void split(P p, I & idx, V & frac) { grainSse2Split(p, idx, frac.a, frac.b); }
+    static inline I step(P p, int bits) { return grainSse2Step(p, bits); }
+    static inline V gather(const double * base, const I & idx, int stride)
+    {
+        V v;
+        v.a = _mm_set_pd(base[idx.k[1] * stride], base[idx.k[0] * stride]);
+        v.b = _mm_set_pd(base[idx.k[3] * stride], base[idx.k[2] * stride]);
+        return v;
+    }
+    //(l0 l1 l2 l3),(r0 r1 r2 r3) -> (l0 r0 l1 r1),(l2 r2 l3 r3)
+    static inline void interleave(V l, V r, V & lo, V & hi)
+    {
+        lo.a = _mm_unpacklo_pd(l.a, r.a);
+        lo.b = _mm_unpackhi_pd(l.a, r.a);
+        hi.a = _mm_unpacklo_pd(l.b, r.b);
+        hi.b = _mm_unpackhi_pd(l.b, r.b);
+    }
+};
+
+template <>
+struct GrainSimd<float>
+{
+    enum { W = 4 };
+    typedef __m128 V;
+    typedef GrainSse2Phase P;
+    typedef GrainSse2Index I;
+
+    static inline V set1(float x) { return _mm_set1_ps(x); }
+    static inline V load(const float * p) { return _mm_loadu_ps(p); }
+    static inline void store(float * p, V v) { _mm_storeu_ps(p, v); }
+    static inline V add(V a, V b) { return _mm_add_ps(a, b); }
+    static inline V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static inline V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static inline V min(V a, V b) { return _mm_min_ps(a, b); }
+    static inline V max(V a, V b) { return _mm_max_ps(a, b); }
+    static inline P ramp(GrainPhase pos, GrainPhase inc) { return grainSse2Ramp(pos, inc); }
+    static inline P advance(P p, GrainPhase step) { return grainSse2Advance(p, step); }
+    static inline void split(P p, I & idx, V & frac)
+    {
+        __m128d f0, f1;
+        grainSse2Split(p, idx, f0, f1);
+        frac = _mm_movelh_ps(_mm_cvtpd_ps(f0), _mm_cvtpd_ps(f1));
+    }
+    static inline I step(P p, int bits) { return grainSse2Step(p, bits); }
+    static inline V gather(const float * base, const I & idx, int stride)
+    {
+        return _mm_set_ps(base[idx.k[3] * stride], base[idx.k[2] * stride], base[idx.k[1] * stride], base[idx.k[0] * stride]);
+    }
+    //(l0 l1 l2 l3),(r0 r1 r2 r3) -> (l0 r0 l1 r1),(l2 r2 l3 r3)
+    static inline void interleave(V l, V r, V & lo, V & hi)
+    {
+        lo = _mm_unpacklo_ps(l, r);
+        hi = _mm_unpackhi_ps(l, r);
+    }
+};
+
+#endif
+
+
+#endif
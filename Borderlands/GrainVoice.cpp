@@ -38,21 +38,6 @@
 GrainVoice::~GrainVoice()
 {
     
-    if (theSounds != NULL)
-        delete theSounds;
-    
-    if (playPositions !=NULL)
-        delete [] playPositions;
-    
-    if (playVols != NULL)
-        delete [] playVols;
-    
-    if (window != NULL)
-        delete[]window;
-    
-    if (activeSounds!=NULL)
-        delete activeSounds;
-  
     if (chanMults)
         delete[] chanMults;
     
@@ -66,59 +51,16 @@ GrainVoice::~GrainVoice()
 // Constructor
 //-----------------------------------------------------------------------------
 
-GrainVoice::GrainVoice(vector<AudioFile *> * soundSet,float durationMs,float thePitch){
-    
-    
-    //store pointer to external vector of sound files 
-    theSounds = soundSet; 
+GrainVoice::GrainVoice(GrainVoiceBank * theBank,const GrainParams * theParams,float thePitch){
     
-    //get number of loaded sounds
-    numSounds = (unsigned int) soundSet->size();
     
-    //no active sounds on instantiation
-    activeSounds = NULL;
-    
-    //set play positions to -1 for all
-    //note - will have to handle files being added at runtime later if it becomes a feature
-    if (numSounds > 0)
-    {
-        playPositions = new double[numSounds];
-        playVols = new double[numSounds];
-        //initialize - (-1 signifies that sound should not be played)
-        for (int i = 0; i < soundSet->size(); i++){
-            playPositions[i] = -1.0;
-            playVols[i] = 0.0;
-        }
-    }else{
-        playPositions = NULL;
-    }
-    
-    //playing status init
-    playingState = false;
-
+    //store pointer to playback state storage
+    bank = theBank;
     
-    //direction
-    if (randf() < 0.5)
-        direction = 1.0;
-    else
-        direction = -1.0;
-    queuedDirection = direction;
-    
-    //set default windowType
-    windowType = HANNING;
-    queuedWindowType = windowType;
-    
-    //window type is hanning
-    window = Window::Instance().getWindow(windowType);
-
     //grain volume
     localAtten = 1.0;
     queuedLocalAtten = localAtten;
     
-    //grain duration (ms)
-    duration = durationMs;
-    queuedDuration = durationMs; 
-    
     //grain playback rate
     pitch = thePitch;
     queuedPitch = pitch;
@@ -133,79 +75,40 @@ GrainVoice::GrainVoice(vector<AudioFile *> * soundSet,float durationMs,float the
         queuedChanMults[i] = 1.0;
     }
     
-        
-    //new input flag (no new inputs on instantiation)
-    newParam = false;
-    
-    //set playhead increment
-    playInc = pitch*direction;
-    //initialize window reading params
-    winReader = 0.0; //0 idx
-    
-    //get duration in samples (fractional)
-    winDurationSamps = ceil(duration * MY_SRATE * (double) 0.001);
-    winInc = (double)WINDOW_LEN / winDurationSamps; 
+    //duration, window, direction and interpolation come from the cloud.
+    //defaults until the first copy succeeds
+    queuedDuration = 500.0;
+    queuedWindowType = HANNING;
+    queuedDirection = 1.0;
+    queuedInterpQuality = INTERP_LINEAR;
+    params = theParams;
+    paramVersion = (unsigned long) -1;
+    takeParams();
+    updateParams();
     
 }
 
 
 //-----------------------------------------------------------------------------
-// Turn on grain.  
-//input args = position and volume vectors in sound rect space
-// returns whether or not grain is awaiting play. 
-// parent cloud will wait to play this voice if the voice is still
-//this should not be an issue unless the overlap value is erroneous 
+// Turn on grain in a pool slot the parent cloud allocated.
+//input args = the sounds under the grain (position and volume in each)
 //-----------------------------------------------------------------------------
-bool GrainVoice::playMe(double * startPositions,double * startVols)
+void GrainVoice::playMe(unsigned int theSlot,const GrainHit * theHits,unsigned int numHits,unsigned int theDelay,double theOnsetFrac)
 {
+    //pick up cloud setting changes made since our last grain
+    if (params->version.load(std::memory_order_relaxed) != paramVersion)
+        takeParams();
     
-    if (playingState == false){        
-        //next buffer call will play
-        playingState = true;
-        
-        //grab queued params if changed
-        if (newParam == true)
-            updateParams();
-        
-        //convert relative start positions to sample locations
-        
-        if (activeSounds != NULL)
-            delete activeSounds;
-        
-        activeSounds = new vector<int>;
-        
-        for (int i = 0; i < numSounds; i++){
-            if (startPositions[i] != -1){
-                activeSounds->push_back(i);
-                playPositions[i] = floor( startPositions[i] * (theSounds->at(i)->frames - 1) );
-                playVols[i] = startVols[i];
-            }
-        }
-        
-        //initialize window reader index
-        winReader = 0;
-        return false;
-        
-    }else{
-        //debug
-        //cout << "Grain triggered too soon..." << endl;
-        return true;
-  
-    }
+    //grab queued params if changed
+    if (newParam == true)
+        updateParams();
+    
+    //next buffer call will play
+    bank->startVoice(theSlot,theHits,numHits,windowType,window,winDurationSamps,winInc,playInc,localAtten,chanMults,interpQuality,theDelay,theOnsetFrac);
 }
 
 
 
-//-----------------------------------------------------------------------------
-// Find out if grain is currently on
-//-----------------------------------------------------------------------------
-bool GrainVoice::isPlaying()
-{
-    return playingState;
-}     
-
-
-
 //-----------------------------------------------------------------------------
 // Set channel multipliers
 //-----------------------------------------------------------------------------
@@ -233,18 +136,6 @@ float GrainVoice::getVolume(){
     return localAtten;
 }
 
-//-----------------------------------------------------------------------------
-// Set duration (effective on next trigger)
-//-----------------------------------------------------------------------------
-void GrainVoice::setDurationMs(float dur)
-{
-    //get absolute value
-    queuedDuration = fabs(dur);
-    if (queuedDuration != duration)
-        newParam = true;
-}     
-
-
 //-----------------------------------------------------------------------------
 // Set pitch (effective on next trigger)
 //-----------------------------------------------------------------------------
@@ -264,6 +155,56 @@ float GrainVoice::getPitch(){
 }
 
 
+//-----------------------------------------------------------------------------
+// Queue the cloud settings (random window/direction modes are resolved per
+// voice here)
+//-----------------------------------------------------------------------------
+bool GrainVoice::takeParams()
+{
+    //read the block, then make sure the cloud was not writing it meanwhile
+    unsigned long version = params->version.load(std::memory_order_acquire);
+    if (version & 1)
+        return false;
+    float theDuration = params->duration.load(std::memory_order_relaxed);
+    int theWindowType = params->windowType.load(std::memory_order_relaxed);
+    int theDirection = params->direction.load(std::memory_order_relaxed);
+    int theInterp = params->interpQuality.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (params->version.load(std::memory_order_relaxed) != version)
+        return false;
+    paramVersion = version;
+    
+    queuedDuration = fabs(theDuration);
+    
+    if (theWindowType == RANDOM_WIN){
+        queuedWindowType = (unsigned int) floor(randf() * NUM_WINDOWS);
+        if (queuedWindowType >= NUM_WINDOWS)
+            queuedWindowType = NUM_WINDOWS - 1;
+    }else{
+        queuedWindowType = theWindowType;
+    }
+    
+    switch (theDirection) {
+        case FORWARD:
+            queuedDirection = 1.0;
+            break;
+        case BACKWARD:
+            queuedDirection = -1.0;
+            break;
+        default:
+            if (randf() < 0.5)
+                queuedDirection = 1.0;
+            else
+                queuedDirection = -1.0;
+            break;
+    }
+    
+    queuedInterpQuality = theInterp;
+    newParam = true;
+    return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Update params
 //-----------------------------------------------------------------------------
@@ -291,6 +232,9 @@ void GrainVoice::updateParams()
     //switch window
     window = Window::Instance().getWindow(windowType);
 
+    //interpolation
+    interpQuality = queuedInterpQuality;
+
     //double value, but eliminate fractional component - 
     winDurationSamps = ceil(duration * MY_SRATE * (double) 0.001);
     
@@ -309,213 +253,6 @@ void GrainVoice::updateParams()
 
 
 
-//-----------------------------------------------------------------------------
-// Set window type (effective on next trigger)
-//-----------------------------------------------------------------------------
-
-void GrainVoice::setWindow(unsigned int theType)
-{
-    queuedWindowType = theType;
-    if (queuedWindowType != windowType)
-        newParam = true;
-}
-
-
-//-----------------------------------------------------------------------------
-// Set direction (effective on next trigger)
-//-----------------------------------------------------------------------------
-
-void GrainVoice::setDirection(float thedir)
-{
-    queuedDirection = thedir;
-    if (queuedDirection != direction)
-        newParam = true;
-}
-
-
-//-----------------------------------------------------------------------------
-// Compute next sub buffer of audio
-//-----------------------------------------------------------------------------
-
-
-void GrainVoice::nextBuffer(double * accumBuff,unsigned int numFrames,unsigned int bufferOffset, int name)
-{
-    
-    //fill stereo accumulation buffer.  note, buffer output must be interlaced ch1,ch2,ch1,ch2, etc...
-    //and playPositions are in frames, NOT SAMPLES.
-    
-    //only go through this ordeal if grain is active
-    if (playingState == true)
-    { 
-        //initialize local vars
-        
-         //linear interp coeff
-        double nu = 0.0;
-        
-         //next window value
-        double nextMult = 0.0;
-        
-        //ref idx for left bound of interp
-        double flooredIdx = 0; 
-        
-        //next file index
-        int nextSound = -1;
-        
-        //waveform params
-        double * wave = NULL;
-        int channels = 0;
-        unsigned int frames = 0;
-        
-        //file reader position
-        double pos = -1.0;
-        
-        //attenuation value
-        double atten = 0.0;
-        
-        //output values 
-        double nextAmp = 0.0;
-        double monoWaveVal = 0.0;
-        double stereoLeftVal = 0.0;
-        double stereoRightVal = 0.0;
-        
-        
-        //iterate over requested number of samples
-        for (int i = 0; i < numFrames; i++)
-        {
-            
-            //Window multiplier - Get next val from window and check to see if we've reached the end
-            if (winReader > (WINDOW_LEN - 1)){
-                nextMult = (double) 0.0;
-                winReader = 0;
-                playingState = false;
-                return;
-            }else{
-                //interpolated read from window buffer
-                flooredIdx = floor(winReader);
-                nu = winReader - flooredIdx; //interp coeff
-                //interpolated read (lin)
-                nextMult = ((double) 1.0 - nu)*window[(unsigned long)flooredIdx] + nu * window[(unsigned long)flooredIdx + 1];
-                //increment reader
-                winReader += winInc;
-            }
-                        
-            
-            //reinit sound accumulators for mono and stereo files to prepare for this frame
-            monoWaveVal = 0.0;
-            stereoLeftVal = 0.0;
-            stereoRightVal = 0.0;
-            
-            //Get next audio frame data (accumulate from each sound under grain) 
-            //-- REMEMBER - playPositions are in frames, not samples
-            for (int j = 0; j < activeSounds->size(); j++){
-                
-                nextSound = activeSounds->at(j);
-                pos = playPositions[nextSound];//get start position
-                atten = playVols[nextSound]; // get volume relative to rect
-                
-                
-                //if sound is in play,sample it
-                if (pos > 0){
-                    
-                    //sound vars
-                    wave = theSounds->at(nextSound)->wave;
-                    channels = theSounds->at(nextSound)->channels;
-                    frames = theSounds->at(nextSound)->frames;
-                    
-                    //get info for interpolation based on frame location
-                    flooredIdx =  floor(pos);
-                    nu =pos - flooredIdx;
-                    
-                    //handle mono and stereo files separately.
-                    switch (channels) {
-                        case 1:   
-                            
-                            //get next linearly interpolated sample val and make sure we are still inside
-                            if ((flooredIdx >=0) && ((flooredIdx + 1) < (frames - 1))){
-                                nextAmp =(((double) 1.0 - nu)*wave[(unsigned long)flooredIdx] + nu * wave[(unsigned long)flooredIdx + 1])*nextMult * atten;
-                               
-                                //accumulate mono frame
-                                monoWaveVal += nextAmp;
-                                
-                                /*//old
-                                 accumBuff[(bufferOffset + i)*MY_CHANNELS] += nextAmp;
-                                //copy to other channels for mono
-                                for (int k = 1; k < MY_CHANNELS; k++){
-                                    accumBuff[(bufferOffset + i) * MY_CHANNELS + k] += nextAmp;
-                                }
-                                 */
-                                
-                                //advance after each stereo frame (do calc twice for mono)
-                                playPositions[nextSound] += playInc;                                    
-                                
-                            }else{
-                                //not playing anymore
-                                playPositions[nextSound] = -1.0;
-                            }
-                            break;
-                        case 2:  //stereo
-                            
-                            //make sure we are still in sound
-                            if ((flooredIdx >=0) && ((flooredIdx + 1) < (frames - 1))){
-                                
-                                
-                                //left channel
-                                stereoLeftVal += (((double) 1.0 - nu)*wave[(unsigned long)flooredIdx*2] + nu * wave[(unsigned long)(flooredIdx + 1)*2])*nextMult*atten;
-                                //right channel
-                                stereoRightVal += (((double) 1.0 - nu)*wave[(unsigned long)flooredIdx*2 + 1] + nu * wave[(unsigned long)(flooredIdx + 1)*2 + 1])*nextMult*atten;
-                              
-                                /*//old
-                                //left channel
-                                accumBuff[(bufferOffset + i)*MY_CHANNELS] += (((double) 1.0 - nu)*wave[(unsigned long)flooredIdx*2] + nu * wave[(unsigned long)(flooredIdx + 1)*2])*nextMult*atten;
-                                
-                                //right channel
-                                accumBuff[(bufferOffset + i) * MY_CHANNELS + 1] += (((double) 1.0 - nu)*wave[(unsigned long)flooredIdx*2 + 1] + nu * wave[(unsigned long)(flooredIdx + 1)*2 + 1])*nextMult*atten;
-                                 */
-                                
-                                //advance after each stereo frame (do calc twice for mono)
-                                playPositions[nextSound] += playInc;                                   
-                                
-                            }else{
-                                //not playing anymore
-                                playPositions[nextSound] = -1.0;
-                            }
-                            break;
-                            //don't handle numbers of channels > 2
-                        default:
-                            break;
-                    }//end switch channels
- 
-                }//end position check
-                
-            }//end accumulation for current frame
-            
-            //spatialize output
-            for (int k = 0; k < MY_CHANNELS; k++){
-                //preserve stereo waveform L/R for now and just sample alternate channels in "AROUND" case (see GrainCluster.cpp updateSpatialization routine)
-                if ((k % 2) == 0){
-                    accumBuff[(bufferOffset + i)*MY_CHANNELS + k] += (stereoLeftVal + monoWaveVal) * chanMults[k] * localAtten;
-                    
-                }else{
-                    accumBuff[(bufferOffset + i)*MY_CHANNELS + k] += (stereoRightVal + monoWaveVal) * chanMults[k] * localAtten;
-                }
-                
-                //clip if needed
-                if (accumBuff[(bufferOffset + i)*MY_CHANNELS + k] > 1.0){
-                    accumBuff[(bufferOffset + i)*MY_CHANNELS + k] = 1.0;
-                }else{
-                    if (accumBuff[(bufferOffset + i)*MY_CHANNELS + k] < -1.0){
-                        accumBuff[(bufferOffset + i)*MY_CHANNELS + k] = -1.0;
-                    }
-                }
-            }
-            
-        }
-    }else{
-        //cout << "return - not playing " << endl;
-        return;
-    }
-}
-
 //----------------------------------------------------------------------------------------------//
 
 
@@ -32,12 +32,14 @@
 
 #include "theglobals.h"
 #include "AudioFileSet.h"
+#include "GrainVoiceBank.h"
 #include "Window.h"
 #include <vector>
 #include <math.h>
 #include <time.h>
 #include <ctime>
 #include <Stk.h>
+#include <atomic>
 
 #ifdef __MACOSX_CORE__
 #include <GLUT/glut.h>
@@ -52,9 +54,27 @@
 class GrainVoice;
 class GrainVis;
 
+//direction modes
+enum {FORWARD, BACKWARD, RANDOM_DIR};
+
+//settings shared by every voice of a cloud.  each voice copies the block
+//when it next triggers after a change, so a change costs the same whatever
+//the number of voices.  published as a seqlock: version is odd while the
+//cloud (one writer, the GUI thread) rewrites the fields, and a voice keeps
+//its copy only if version was even and unchanged across its reads
+struct GrainParams
+{
+    std::atomic<unsigned long> version;
+    std::atomic<float> duration; //ms
+    std::atomic<int> windowType; //RANDOM_WIN = each voice picks its own
+    std::atomic<int> direction; //FORWARD, BACKWARD or RANDOM_DIR (each voice picks its own)
+    std::atomic<int> interpQuality;
+};
 
 
 //AUDIO CLASS
+//holds the user parameters of one voice.  playback state lives in the
+//shared GrainVoiceBank pool, in whichever slot the cloud allocated
 class GrainVoice
 {
     
@@ -62,23 +82,15 @@ public:
     //destructor
     virtual ~GrainVoice();
     
-    // constructor
-    GrainVoice(vector<AudioFile *> * soundSet,float durationMs,float thePitch);
+    // constructor (takes its settings from the cloud's theParams)
+    GrainVoice(GrainVoiceBank * theBank,const GrainParams * theParams,float thePitch);
     
-    //dump samples into next buffer
-    void nextBuffer(double * accumBuff,unsigned int numFrames,unsigned int bufferPos, int name);
+    //set on in pool slot theSlot, playing the numHits sounds under the grain
+    //(first frame theDelay frames into the next render, theOnsetFrac of a
+    //frame after the exact onset)
+    void playMe(unsigned int theSlot,const GrainHit * theHits,unsigned int numHits,unsigned int theDelay = 0,double theOnsetFrac = 0.0);
     
-    
-    //set on
-    bool playMe(double * startPositions,double * startVols);
-
-    //report state
-    bool isPlaying();
-    
-    //queue up params for next grain
-    void setDurationMs(float dur);
-    
-    //set/get playback rate
+    //set playback rate (per grain - effective on next trigger)
     void setPitch(float newPitch);
     
     //get playback rate
@@ -91,29 +103,27 @@ public:
     //set spatialization
     void setChannelMultipliers(double* multipliers);
     
-    //set playback direction
-    void setDirection(float thedir);
-    
-    //change window type
-    void setWindow(unsigned int windowType);
-    
     
 protected:
+    //queue the cloud's current settings (false = the block was being
+    //written - try again next time)
+    bool takeParams();
+    
     //makes temp  params permanent
     void updateParams();
     
 private:
     
-    //pointer to all audio file buffers
-    vector <AudioFile *> *theSounds;
-    //status
-    bool playingState;
+    //playback state storage
+    GrainVoiceBank * bank;
+    
+    //cloud settings, and the version last taken from them
+    const GrainParams * params;
+    unsigned long paramVersion;
+    
     //param update required flag
     bool newParam;
     
-    //numsounds
-    unsigned int numSounds;
-    
     //grain parameters
     float duration, queuedDuration;
     double winDurationSamps;
@@ -129,24 +139,17 @@ private:
     double * chanMults;
     double * queuedChanMults;
     
-    //audio files being sampled
-    vector<int> * activeSounds;
-    
     //window type
     unsigned int windowType,queuedWindowType;
     
-    //window reading params
+    //interpolation quality
+    int interpQuality,queuedInterpQuality;
+    
+    //window reading increment
     double winInc;
-    double winReader;
     
     //pointer to audio window (hanning, triangle, etc.)
-    double * window;
-    
-    
-    //array of position values (in frames, not samples)
-    //-1 means not in current soundfile
-    double * playPositions;
-    double * playVols;
+    const SAMPLE * window;
 };
 
 
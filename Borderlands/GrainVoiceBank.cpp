@@ -0,0 +1,743 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  GrainVoiceBank.cpp
+//  Borderlands
+//
+
+#include "GrainVoiceBank.h"
+#include <limits.h>
+
+
+//-----------------------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------------------
+GrainVoiceBank::~GrainVoiceBank()
+{
+    for (unsigned int v = 0; v < numVoices; v++)
+        stopVoice(v);
+
+    grainFree(playing);
+    grainFree(owner);
+    grainFree(priority);
+    grainFree(serial);
+    grainFree(level);
+    grainFree(fadeLeft);
+    grainFree(winPhase);
+    grainFree(winInc);
+    grainFree(startDelay);
+    grainFree(interp);
+    grainFree(window);
+    grainFree(winShape);
+    grainFree(envelope);
+    grainFree(envFrame);
+    grainFree(chanGains);
+    grainFree(numSources);
+    grainFree(srcSound);
+    grainFree(srcWave);
+    grainFree(srcFrames);
+    grainFree(srcChannels);
+    grainFree(srcPos);
+    grainFree(srcInc);
+    grainFree(srcVol);
+    grainFree(srcKernel);
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+GrainVoiceBank::GrainVoiceBank(vector<AudioFile *> * soundSet, unsigned int thePoolSize)
+{
+    //store pointer to external vector of sound files
+    theSounds = soundSet;
+    soundCount = NULL;
+
+    //nothing allocated yet
+    capacity = 0;
+    numVoices = 0;
+    voiceFrames = 0;
+    skippedFrames = 0;
+    stolenGrains = 0;
+    droppedGrains = 0;
+    nextSerial = 0;
+    playing = NULL;
+    maskWords = 0;
+    owner = NULL;
+    priority = NULL;
+    serial = NULL;
+    level = NULL;
+    fadeLeft = NULL;
+    winPhase = NULL;
+    winInc = NULL;
+    startDelay = NULL;
+    interp = NULL;
+    window = NULL;
+    winShape = NULL;
+    envelope = NULL;
+    envFrame = NULL;
+    chanGains = NULL;
+    numSources = NULL;
+    srcSound = NULL;
+    srcWave = NULL;
+    srcFrames = NULL;
+    srcChannels = NULL;
+    srcPos = NULL;
+    srcInc = NULL;
+    srcVol = NULL;
+    srcKernel = NULL;
+
+    //every slot is allocated up front - nothing grows on the audio thread
+    if (thePoolSize < 1)
+        thePoolSize = 1;
+    poolSize = thePoolSize;
+    maxPolyphony = poolSize;
+    stealPolicy = STEAL_OLDEST;
+    interpLimit = NUM_INTERP - 1;
+    cloudVoiceCap = 0;
+    numVoices = poolSize + GRAIN_STEAL_SLOTS;
+    reserve(numVoices);
+    memset(envelope, 0, sizeof(GrainEnvelope *) * numVoices);
+    memset(fadeLeft, 0, sizeof(unsigned int) * numVoices);
+
+    //start the envelope cache (mutex, builder thread) here rather than in
+    //the first startVoice on the audio thread
+    EnvelopeCache::Instance();
+}
+
+
+//-----------------------------------------------------------------------------
+// Grow parallel arrays (existing voice state is preserved)
+//-----------------------------------------------------------------------------
+
+//copy old array into a new aligned one of newCount entries
+template <typename T>
+static T * growArray(T * old, unsigned long oldCount, unsigned long newCount)
+{
+    T * fresh = (T *) grainAlloc(sizeof(T) * newCount);
+    if (old != NULL){
+        memcpy(fresh, old, sizeof(T) * oldCount);
+        grainFree(old);
+    }
+    return fresh;
+}
+
+void GrainVoiceBank::reserve(unsigned int theNumVoices)
+{
+    if (theNumVoices <= capacity)
+        return;
+
+    //grow geometrically so adding voices one at a time stays cheap
+    unsigned int newCap = (capacity > 0) ? capacity : 8;
+    while (newCap < theNumVoices)
+        newCap *= 2;
+
+    //new mask words start out silent
+    unsigned int newWords = (newCap + GRAIN_MASK_BITS - 1) / GRAIN_MASK_BITS;
+    playing = growArray(playing, maskWords, newWords);
+    memset(playing + maskWords, 0, sizeof(unsigned long long) * (newWords - maskWords));
+    maskWords = newWords;
+    owner = growArray(owner, capacity, newCap);
+    priority = growArray(priority, capacity, newCap);
+    serial = growArray(serial, capacity, newCap);
+    level = growArray(level, capacity, newCap);
+    fadeLeft = growArray(fadeLeft, capacity, newCap);
+    winPhase = growArray(winPhase, capacity, newCap);
+    winInc = growArray(winInc, capacity, newCap);
+    startDelay = growArray(startDelay, capacity, newCap);
+    interp = growArray(interp, capacity, newCap);
+    window = growArray(window, capacity, newCap);
+    winShape = growArray(winShape, capacity, newCap);
+    envelope = growArray(envelope, capacity, newCap);
+    envFrame = growArray(envFrame, capacity, newCap);
+    chanGains = growArray(chanGains, (unsigned long) capacity * MY_CHANNELS, (unsigned long) newCap * MY_CHANNELS);
+    numSources = growArray(numSources, capacity, newCap);
+    srcSound = growArray(srcSound, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcWave = growArray(srcWave, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcFrames = growArray(srcFrames, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcChannels = growArray(srcChannels, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcPos = growArray(srcPos, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcInc = growArray(srcInc, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcVol = growArray(srcVol, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+    srcKernel = growArray(srcKernel, (unsigned long) capacity * MAX_GRAIN_SOURCES, (unsigned long) newCap * MAX_GRAIN_SOURCES);
+
+    capacity = newCap;
+}
+
+
+//-----------------------------------------------------------------------------
+// Sounds we may read (see startVoice)
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::setSoundCount(const std::atomic<unsigned int> * theCount)
+{
+    soundCount = theCount;
+}
+
+
+//-----------------------------------------------------------------------------
+// Polyphony and stealing
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::setMaxPolyphony(unsigned int theMax)
+{
+    if (theMax < 1)
+        theMax = 1;
+    if (theMax > poolSize)
+        theMax = poolSize;
+    maxPolyphony = theMax;
+}
+
+unsigned int GrainVoiceBank::getMaxPolyphony()
+{
+    return maxPolyphony;
+}
+
+void GrainVoiceBank::setStealPolicy(int thePolicy)
+{
+    stealPolicy = thePolicy % NUM_STEAL_POLICIES;
+    if (stealPolicy < 0)
+        stealPolicy += NUM_STEAL_POLICIES;
+}
+
+int GrainVoiceBank::getStealPolicy()
+{
+    return stealPolicy;
+}
+
+void GrainVoiceBank::setInterpolationLimit(int theLimit)
+{
+    if (theLimit < INTERP_LINEAR)
+        theLimit = INTERP_LINEAR;
+    if (theLimit > NUM_INTERP - 1)
+        theLimit = NUM_INTERP - 1;
+    interpLimit = theLimit;
+}
+
+int GrainVoiceBank::getInterpolationLimit()
+{
+    return interpLimit;
+}
+
+void GrainVoiceBank::setCloudVoiceCap(unsigned int theCap)
+{
+    cloudVoiceCap = theCap;
+}
+
+unsigned int GrainVoiceBank::getCloudVoiceCap()
+{
+    return cloudVoiceCap;
+}
+
+
+//-----------------------------------------------------------------------------
+// Pick a voice to steal: oldest, quietest (then oldest) or lowest cloud
+// priority (then oldest - never from a cloud above the new grain's)
+//-----------------------------------------------------------------------------
+int GrainVoiceBank::pickVictim(int thePriority)
+{
+    int victim = -1;
+    for (unsigned int w = 0; w < maskWords; w++){
+        for (unsigned long long bits = playing[w]; bits != 0; bits &= bits - 1){
+            const unsigned int v = w * GRAIN_MASK_BITS + grainLowestBit(bits);
+            if (fadeLeft[v] > 0)
+                continue;
+            if (victim < 0){
+                victim = v;
+                continue;
+            }
+            bool better;
+            switch (stealPolicy) {
+                case STEAL_QUIETEST:
+                    better = (level[v] < level[victim]) ||
+                             ((level[v] == level[victim]) && (serial[v] < serial[victim]));
+                    break;
+                case STEAL_PRIORITY:
+                    better = (priority[v] < priority[victim]) ||
+                             ((priority[v] == priority[victim]) && (serial[v] < serial[victim]));
+                    break;
+                default:
+                    better = (serial[v] < serial[victim]);
+                    break;
+            }
+            if (better)
+                victim = v;
+        }
+    }
+    if ((stealPolicy == STEAL_PRIORITY) && (victim >= 0) && (priority[victim] > thePriority))
+        return -1;
+    return victim;
+}
+
+
+//-----------------------------------------------------------------------------
+// Claim a slot for a new grain
+//-----------------------------------------------------------------------------
+int GrainVoiceBank::allocate(unsigned int theOwner, int thePriority)
+{
+    //count sounding voices (all, and the owner's)
+    unsigned int active = 0;
+    unsigned int owned = 0;
+    int shortestFade = -1;
+    for (unsigned int w = 0; w < maskWords; w++){
+        for (unsigned long long bits = playing[w]; bits != 0; bits &= bits - 1){
+            const unsigned int v = w * GRAIN_MASK_BITS + grainLowestBit(bits);
+            if (fadeLeft[v] == 0){
+                active++;
+                if (owner[v] == theOwner)
+                    owned++;
+            }
+            else if ((shortestFade < 0) || (fadeLeft[v] < fadeLeft[shortestFade]))
+                shortestFade = v;
+        }
+    }
+
+    //cloud at its share of the pool
+    if ((cloudVoiceCap > 0) && (owned >= cloudVoiceCap)){
+        droppedGrains++;
+        return -1;
+    }
+
+    //lowest silent slot
+    int freeSlot = -1;
+    for (unsigned int w = 0; (w < maskWords) && (freeSlot < 0); w++){
+        if (~playing[w] != 0){
+            const unsigned int v = w * GRAIN_MASK_BITS + grainLowestBit(~playing[w]);
+            if (v < numVoices)
+                freeSlot = v;
+        }
+    }
+
+    //full - fade a voice out to make room (it finishes in a spare slot)
+    if (active >= maxPolyphony){
+        int victim = (stealPolicy == STEAL_NONE) ? -1 : pickVictim(thePriority);
+        if (victim < 0){
+            droppedGrains++;
+            return -1;
+        }
+        stolenGrains++;
+        if (startDelay[victim] > 0){
+            //not audible yet - no fade needed
+            stopVoice(victim);
+            if ((freeSlot < 0) || (victim < freeSlot))
+                freeSlot = victim;
+        }else{
+            fadeLeft[victim] = GRAIN_STEAL_FADE;
+            if ((shortestFade < 0) || (fadeLeft[victim] < fadeLeft[shortestFade]))
+                shortestFade = victim;
+        }
+    }
+
+    //no spare slot either (lots of steals at once) - cut the voice closest
+    //to the end of its fade
+    if (freeSlot < 0){
+        if (shortestFade < 0){
+            droppedGrains++;
+            return -1;
+        }
+        freeSlot = shortestFade;
+        stopVoice(freeSlot);
+    }
+
+    owner[freeSlot] = theOwner;
+    priority[freeSlot] = thePriority;
+    return freeSlot;
+}
+
+
+//-----------------------------------------------------------------------------
+// Silence a cloud's voices
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::releaseOwner(unsigned int theOwner)
+{
+    for (unsigned int w = 0; w < maskWords; w++){
+        for (unsigned long long bits = playing[w]; bits != 0; bits &= bits - 1){
+            const unsigned int v = w * GRAIN_MASK_BITS + grainLowestBit(bits);
+            if (owner[v] == theOwner)
+                stopVoice(v);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Start a grain - convert relative start positions to frame locations
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::startVoice(unsigned int idx, const GrainHit * theHits, unsigned int numHits,
+                                unsigned int theWindowType, const SAMPLE * theWindow, double theWinDurationSamps,
+                                double theWinInc, double thePlayInc, double theGain, double * theChanMults,
+                                int theInterp, unsigned int theDelay, double theOnsetFrac)
+{
+    if (idx >= numVoices)
+        return;
+    if (theInterp > interpLimit)
+        theInterp = interpLimit;
+
+    //loudest output channel - sources below GRAIN_SILENT_GAIN after it are not played
+    double loudest = 0.0;
+    for (int k = 0; k < MY_CHANNELS; k++){
+        if (fabs(theChanMults[k] * theGain) > loudest)
+            loudest = fabs(theChanMults[k] * theGain);
+    }
+
+    unsigned int count = 0;
+    //sounds can be added while we run (bounces) - only read the published
+    //ones, and without at()/size(), which read the end the ui thread moves
+    unsigned int numSounds = soundCount ? soundCount->load(std::memory_order_acquire) : (unsigned int) theSounds->size();
+    unsigned long base = (unsigned long) idx * MAX_GRAIN_SOURCES;
+    for (unsigned int h = 0; (h < numHits) && (count < MAX_GRAIN_SOURCES); h++){
+        const unsigned int i = theHits[h].sound;
+        if ((i < numSounds) && (fabs(theHits[h].volume) * loudest >= GRAIN_SILENT_GAIN)){
+            AudioFile * theSound = (*theSounds)[i];
+            GrainPhase pos = grainPhaseFrames((long long) floor( theHits[h].position * (theSound->frames - 1) ));
+            //a grain starting on the first frame never sounds
+            if (pos <= 0)
+                continue;
+            //fast grains read a band limited octave copy, keeping the stride near 1
+            unsigned int oct = 0;
+            double octInc = thePlayInc;
+            while ((oct < theSound->numOctaves) && (fabs(octInc) >= GRAIN_OCTAVE_SWITCH)){
+                octInc *= 0.5;
+                oct++;
+            }
+            srcSound[base + count] = i;
+            srcWave[base + count] = theSound->octaveWave[oct];
+            srcFrames[base + count] = theSound->octaveFrames[oct];
+            srcChannels[base + count] = theSound->channels;
+            //the first frame lands theOnsetFrac of a frame into the grain
+            srcPos[base + count] = (pos >> oct) + grainPhase(theOnsetFrac * octInc);
+            srcInc[base + count] = grainPhase(octInc);
+            srcVol[base + count] = theHits[h].volume;
+            //render path for this (file channels, output channels, interpolator)
+            srcKernel[base + count] = grainSourceKernel(theSound->channels, theInterp);
+            count++;
+        }
+    }
+    numSources[idx] = count;
+    interp[idx] = (unsigned char) theInterp;
+
+    //peak gain for STEAL_QUIETEST
+    double loudestSrc = 0.0;
+    for (unsigned int j = 0; j < count; j++){
+        if (fabs(srcVol[base + j]) > loudestSrc)
+            loudestSrc = fabs(srcVol[base + j]);
+    }
+    level[idx] = loudest * loudestSrc;
+
+    window[idx] = theWindow;
+    winInc[idx] = grainPhase(theWinInc);
+    //shapes with a closed form are computed as the grain plays, otherwise use the
+    //shared envelope for this window/duration if it has been built
+    EnvelopeCache::Instance().release(envelope[idx]);
+    if (GRAIN_ANALYTIC_ENVELOPES && grainOscSupported(theWindowType)){
+        winShape[idx] = (unsigned char) theWindowType;
+        envelope[idx] = NULL;
+    }else{
+        winShape[idx] = GRAIN_TABLE_ENVELOPE;
+        envelope[idx] = EnvelopeCache::Instance().acquire(theWindowType, (unsigned long) theWinDurationSamps);
+    }
+    envFrame[idx] = 0;
+    //pan and grain volume fold into one gain per output channel
+    for (int k = 0; k < MY_CHANNELS; k++)
+        chanGains[idx*MY_CHANNELS + k] = (SAMPLE) (theChanMults[k] * theGain);
+
+    //initialize window reader index - next buffer call will play, starting
+    //theDelay frames in.  (prebuilt envelopes are read from their first
+    //frame - the fraction moves them by less than one envelope step)
+    winPhase[idx] = grainPhase(theOnsetFrac * theWinInc);
+    startDelay[idx] = theDelay;
+    fadeLeft[idx] = 0;
+    serial[idx] = nextSerial++;
+    playing[idx / GRAIN_MASK_BITS] |= 1ULL << (idx % GRAIN_MASK_BITS);
+
+    //nothing audible under the grain - it never needs the slot
+    if (count == 0){
+        unsigned long silent = framesLeft(idx) - theDelay;
+        voiceFrames += silent;
+        skippedFrames += silent;
+        stopVoice(idx);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Stop a voice
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::stopVoice(unsigned int v)
+{
+    playing[v / GRAIN_MASK_BITS] &= ~(1ULL << (v % GRAIN_MASK_BITS));
+    fadeLeft[v] = 0;
+    EnvelopeCache::Instance().release(envelope[v]);
+    envelope[v] = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Remove a finished source (order of the remaining sources is kept)
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::retireSource(unsigned int v, unsigned int j)
+{
+    const unsigned long base = (unsigned long) v * MAX_GRAIN_SOURCES;
+    for (unsigned int k = j + 1; k < numSources[v]; k++){
+        srcSound[base + k - 1] = srcSound[base + k];
+        srcWave[base + k - 1] = srcWave[base + k];
+        srcFrames[base + k - 1] = srcFrames[base + k];
+        srcChannels[base + k - 1] = srcChannels[base + k];
+        srcPos[base + k - 1] = srcPos[base + k];
+        srcInc[base + k - 1] = srcInc[base + k];
+        srcVol[base + k - 1] = srcVol[base + k];
+        srcKernel[base + k - 1] = srcKernel[base + k];
+    }
+    numSources[v]--;
+}
+
+
+//-----------------------------------------------------------------------------
+// Find out if grain in slot idx is currently on
+//-----------------------------------------------------------------------------
+bool GrainVoiceBank::isPlaying(unsigned int idx)
+{
+    return (idx < numVoices) && (((playing[idx / GRAIN_MASK_BITS] >> (idx % GRAIN_MASK_BITS)) & 1) != 0);
+}
+
+unsigned int GrainVoiceBank::getActiveVoices()
+{
+    unsigned int active = 0;
+    for (unsigned int w = 0; w < maskWords; w++){
+        for (unsigned long long bits = playing[w]; bits != 0; bits &= bits - 1){
+            if (fadeLeft[w * GRAIN_MASK_BITS + grainLowestBit(bits)] == 0)
+                active++;
+        }
+    }
+    return active;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frames until the slot frees up
+//-----------------------------------------------------------------------------
+unsigned long GrainVoiceBank::framesLeft(unsigned int idx)
+{
+    if (!isPlaying(idx))
+        return 0;
+    unsigned long left;
+    if (envelope[idx] != NULL)
+        left = envelope[idx]->frames - envFrame[idx];
+    else
+        left = grainWindowFrames(winPhase[idx], winInc[idx], INT_MAX);
+    return startDelay[idx] + left;
+}
+
+
+//-----------------------------------------------------------------------------
+// Culling statistics
+//-----------------------------------------------------------------------------
+unsigned long long GrainVoiceBank::getVoiceFrames()
+{
+    return voiceFrames;
+}
+
+unsigned long long GrainVoiceBank::getSkippedFrames()
+{
+    return skippedFrames;
+}
+
+unsigned long long GrainVoiceBank::getStolenGrains()
+{
+    return stolenGrains;
+}
+
+unsigned long long GrainVoiceBank::getDroppedGrains()
+{
+    return droppedGrains;
+}
+
+
+//-----------------------------------------------------------------------------
+// Render a cloud's voices (in slot order) into its bus.  only sounding slots
+// are visited - a voice that finishes clears its bit, the loop works from a
+// copy of each word
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::nextBuffer(unsigned int theOwner, SAMPLE * bus, unsigned long busFrames, unsigned int numFrames, unsigned int bufferOffset)
+{
+    for (unsigned int w = 0; w < maskWords; w++){
+        for (unsigned long long bits = playing[w]; bits != 0; bits &= bits - 1){
+            const unsigned int v = w * GRAIN_MASK_BITS + grainLowestBit(bits);
+            if (owner[v] == theOwner)
+                renderVoice(v, bus, busFrames, numFrames, bufferOffset);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Compute next sub buffer of audio for one voice
+//-----------------------------------------------------------------------------
+void GrainVoiceBank::renderVoice(unsigned int v, SAMPLE * bus, unsigned long busFrames, unsigned int numFrames, unsigned int bufferOffset)
+{
+    //fill the cloud bus (planar - channel k starts at bus + k*busFrames).
+    //positions are in frames, NOT SAMPLES.
+
+    //scratch buffers for one run of frames (window, planar output channel sums)
+    SAMPLE envBuff[GRAIN_BLOCK] GRAIN_ALIGN;
+    SAMPLE acc[GRAIN_BLOCK*MY_CHANNELS] GRAIN_ALIGN;
+
+    //not started yet - wait out the onset delay
+    const unsigned int wait = startDelay[v];
+    if (wait > 0){
+        if (wait >= numFrames){
+            startDelay[v] = wait - numFrames;
+            return;
+        }
+        startDelay[v] = 0;
+        bufferOffset += wait;
+        numFrames -= wait;
+    }
+
+    //voice state
+    GrainPhase reader = winPhase[v];
+    const GrainPhase inc = winInc[v];
+    const SAMPLE * win = window[v];
+    const GrainEnvelope * cached = envelope[v];
+    const int shape = winShape[v];
+    //frames the interpolator reads around the playhead
+    const int before = grainInterpBefore(interp[v]);
+    const int after = grainInterpAfter(interp[v]);
+    unsigned long frame = envFrame[v];
+    const unsigned long base = (unsigned long) v * MAX_GRAIN_SOURCES;
+
+    //frames rendered so far
+    unsigned int done = 0;
+
+    //render in runs of at most GRAIN_BLOCK frames
+    for (;;)
+    {
+        //Window multiplier - check to see if we've reached the end (also after
+        //the last run, so the slot is free as soon as the grain is over)
+        if ((cached != NULL) ? (frame >= cached->frames) : (reader > grainPhaseFrames(WINDOW_LEN - 1))){
+            reader = 0;
+            stopVoice(v);
+            break;
+        }
+        if (done >= numFrames)
+            break;
+
+        //every source has run off its file - the rest of the grain is silent,
+        //so give the slot back now
+        if (numSources[v] == 0){
+            winPhase[v] = reader;
+            envFrame[v] = frame;
+            unsigned long left = framesLeft(v);
+            voiceFrames += left;
+            skippedFrames += left;
+            reader = 0;
+            stopVoice(v);
+            break;
+        }
+
+        //length of this run - stop early if the window ends inside it
+        int n = numFrames - done;
+        if (n > GRAIN_BLOCK)
+            n = GRAIN_BLOCK;
+
+        const SAMPLE * env;
+        if (cached != NULL){
+            //prebuilt envelope - plain read
+            if (cached->frames - frame < (unsigned long) n)
+                n = (int) (cached->frames - frame);
+            env = cached->data + frame;
+        }else if (shape != GRAIN_TABLE_ENVELOPE){
+            //computed from the reader position
+            n = grainWindowFrames(reader, inc, n);
+            grainOscEnvelope(shape, reader, inc, envBuff, n);
+            env = envBuff;
+        }else{
+            //interpolated read from window buffer
+            n = grainWindowFrames(reader, inc, n);
+            grainEnvelope(win, reader, inc, envBuff, n);
+            env = envBuff;
+        }
+
+        //stolen - ramp down over the rest of the fade
+        const unsigned int fade = fadeLeft[v];
+        if (fade > 0){
+            if ((unsigned int) n > fade)
+                n = (int) fade;
+            for (int i = 0; i < n; i++)
+                envBuff[i] = env[i] * (SAMPLE) ((double) (fade - i) / (double) GRAIN_STEAL_FADE);
+            env = envBuff;
+        }
+
+        //reinit sound accumulators to prepare for this run
+        for (int k = 0; k < MY_CHANNELS; k++)
+            memset(acc + k*GRAIN_BLOCK, 0, sizeof(SAMPLE)*n);
+
+        //Get next audio frames (accumulate from each sound under grain)
+        for (unsigned int j = 0; j < numSources[v]; ){
+            const unsigned long s = base + j;
+            GrainPhase pos = srcPos[s];
+
+            //frames this source stays inside its file - no per frame checks below
+            const GrainPhase pInc = srcInc[s];
+            int span = grainSourceSpan(pos, pInc, srcFrames[s], n, before, after);
+            if (span > 0){
+                srcKernel[s](srcWave[s], srcChannels[s], pos, pInc, (SAMPLE) srcVol[s], env, acc, span);
+                pos += span * pInc;
+            }
+
+            //not playing anymore
+            if (span < n){
+                retireSource(v, j);
+                continue;
+            }
+
+            srcPos[s] = pos;
+            j++;
+        }//end accumulation for current run
+
+        //pan into the cloud bus (file channels were already mapped to output channels,
+        //so "AROUND" just picks channels - see GrainCluster.cpp updateSpatialization routine)
+        grainPan(acc, chanGains + v*MY_CHANNELS, bus + bufferOffset + done, busFrames, n);
+
+        //advance window reader
+        if (cached != NULL){
+            frame += n;
+        }else{
+            reader += n * inc;
+        }
+
+        done += n;
+
+        //fade finished
+        if (fade > 0){
+            fadeLeft[v] = fade - n;
+            if (fadeLeft[v] == 0){
+                reader = 0;
+                stopVoice(v);
+                break;
+            }
+        }
+    }
+
+    voiceFrames += done;
+    winPhase[v] = reader;
+    envFrame[v] = frame;
+}
@@ -0,0 +1,240 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  GrainVoiceBank.h
+//  Borderlands
+//
+//  Playback state for every grain voice in the program: one preallocated
+//  pool shared by all clouds, stored as parallel (structure of arrays)
+//  aligned buffers.  Clouds ask the pool for a slot when a grain is due and
+//  GrainVoice objects (the cold user parameters) write into it.  At most
+//  maxPolyphony voices sound at once; past that the stealing policy picks a
+//  voice to fade out quickly, or the new grain is dropped.  Each cloud
+//  renders its own voices into its planar mix bus; volume and interleaving
+//  happen once per cloud (see GrainCluster::nextBuffer).
+//
+
+
+#ifndef GRAINVOICEBANK_H
+#define GRAINVOICEBANK_H
+
+#include "theglobals.h"
+#include "AudioFileSet.h"
+#include "GrainKernels.h"
+#include "EnvelopeCache.h"
+#include "GrainOscEnv.h"
+#include <vector>
+#include <atomic>
+
+using namespace std;
+
+//a grain reads the next octave copy down once its stride reaches this
+//(geometric midpoint between octaves, so strides stay within 0.71 .. 1.41)
+#define GRAIN_OCTAVE_SWITCH 1.41421356
+
+//sources quieter than this (source volume * grain gain * loudest channel,
+//about -80 dB) are dropped when the grain is triggered
+#define GRAIN_SILENT_GAIN 1.0e-4
+
+//voice envelope read from a table (window or prebuilt) rather than computed
+#define GRAIN_TABLE_ENVELOPE 0xff
+
+//extra slots for stolen voices to fade out in, and the fade length (frames)
+#define GRAIN_STEAL_SLOTS 16
+#define GRAIN_STEAL_FADE 64
+
+//slots per word of the sounding-voice bitmask
+#define GRAIN_MASK_BITS 64
+
+//index of the lowest set bit (bits != 0)
+static inline unsigned int grainLowestBit(unsigned long long bits)
+{
+    return (unsigned int) __builtin_ctzll(bits);
+}
+
+//a sound under a grain at trigger: which file, where the grain starts in
+//it (0 .. 1) and its volume
+struct GrainHit
+{
+    unsigned int sound;
+    double position;
+    double volume;
+};
+
+//voice stealing policies (what to do when maxPolyphony voices are sounding)
+enum {STEAL_OLDEST, STEAL_QUIETEST, STEAL_PRIORITY, STEAL_NONE, NUM_STEAL_POLICIES};
+
+
+class GrainVoiceBank
+{
+
+public:
+    //destructor
+    virtual ~GrainVoiceBank();
+
+    //constructor - room for poolSize voices (plus fade out slots), all allocated here
+    GrainVoiceBank(vector<AudioFile *> * soundSet, unsigned int poolSize = MAX_POLYPHONY);
+
+    //sounds of soundSet this pool may read, when the ui thread appends to it
+    //while we run (raised with release after each append).  NULL = all
+    void setSoundCount(const std::atomic<unsigned int> * theCount);
+
+    //voices allowed to sound at once (1 .. pool size)
+    void setMaxPolyphony(unsigned int theMax);
+    unsigned int getMaxPolyphony();
+
+    //what happens when a grain arrives with every voice busy (STEAL_*)
+    void setStealPolicy(int thePolicy);
+    int getStealPolicy();
+
+    //load shedding (see Governor.h): highest interpolation quality new grains
+    //get, and voices one cloud may hold (0 = no cap - past it grains are dropped)
+    void setInterpolationLimit(int theLimit);
+    int getInterpolationLimit();
+    void setCloudVoiceCap(unsigned int theCap);
+    unsigned int getCloudVoiceCap();
+
+    //claim a slot for a grain from cloud owner (priority used by STEAL_PRIORITY,
+    //higher wins).  steals a voice if the pool is full; -1 = grain dropped
+    int allocate(unsigned int owner, int priority);
+
+    //start a grain in slot idx (from allocate) on the numHits sounds in theHits
+    //(at most MAX_GRAIN_SOURCES are kept).  theInterp is an INTERP_* quality.
+    //the grain's first frame is theDelay frames into the next render call and
+    //theOnsetFrac (0 .. 1) of a frame after its true onset
+    void startVoice(unsigned int idx, const GrainHit * theHits, unsigned int numHits,
+                    unsigned int theWindowType, const SAMPLE * theWindow, double theWinDurationSamps,
+                    double theWinInc, double thePlayInc, double theGain, double * theChanMults,
+                    int theInterp, unsigned int theDelay = 0, double theOnsetFrac = 0.0);
+
+    //silence every voice of a cloud (render thread - clouds call it when they
+    //are switched off or deleted)
+    void releaseOwner(unsigned int owner);
+
+    //report state
+    bool isPlaying(unsigned int idx);
+    unsigned int getActiveVoices();
+
+    //voice frames played so far, and how many of them were skipped because
+    //the grain had no audible source left
+    unsigned long long getVoiceFrames();
+    unsigned long long getSkippedFrames();
+
+    //grains that took a voice from another grain / found no voice
+    unsigned long long getStolenGrains();
+    unsigned long long getDroppedGrains();
+
+    //render every sounding voice of cloud owner into its bus (planar, busFrames per channel)
+    void nextBuffer(unsigned int owner, SAMPLE * bus, unsigned long busFrames, unsigned int numFrames, unsigned int bufferOffset);
+
+protected:
+    //grow parallel arrays to hold at least numVoices slots
+    void reserve(unsigned int numVoices);
+
+    //turn voice off and let go of its envelope
+    void stopVoice(unsigned int v);
+
+    //frames until slot idx is free again (onset delay plus what is left of its window)
+    unsigned long framesLeft(unsigned int idx);
+
+    //voice to give up its slot under the current policy (-1 = none may be taken)
+    int pickVictim(int priority);
+
+    //drop source j of voice v once it has run off its file
+    void retireSource(unsigned int v, unsigned int j);
+
+    //render one voice
+    void renderVoice(unsigned int v, SAMPLE * bus, unsigned long busFrames, unsigned int numFrames, unsigned int bufferOffset);
+
+private:
+    //pointer to all audio file buffers
+    vector<AudioFile *> * theSounds;
+    const std::atomic<unsigned int> * soundCount;
+
+    //slots in use (pool size plus fade out slots) / allocated
+    unsigned int numVoices;
+    unsigned int capacity;
+
+    //polyphony cap (at most the pool size) and stealing policy
+    unsigned int poolSize;
+    unsigned int maxPolyphony;
+    int stealPolicy;
+
+    //load shedding limits
+    int interpLimit;
+    unsigned int cloudVoiceCap;
+
+    //start order of grains (for STEAL_OLDEST)
+    unsigned long long nextSerial;
+
+    //culling and stealing statistics
+    unsigned long long voiceFrames;
+    unsigned long long skippedFrames;
+    unsigned long long stolenGrains;
+    unsigned long long droppedGrains;
+
+    //sounding voices, one bit per slot (capacity / GRAIN_MASK_BITS words).
+    //everything that walks the voices visits only the set bits
+    unsigned long long * playing;
+    unsigned int maskWords;
+
+    //per voice state (parallel arrays, capacity entries each)
+    //owning cloud, its priority, start order and peak gain at trigger
+    unsigned int * owner;
+    int * priority;
+    unsigned long long * serial;
+    double * level;
+    //frames left of the fade out once stolen (0 = not stolen)
+    unsigned int * fadeLeft;
+    //frames to wait before the grain's first frame
+    unsigned int * startDelay;
+    //window reader increments are 32.32 fixed point
+    GrainPhase * winPhase;
+    GrainPhase * winInc;
+    //interpolation quality (selects the source kernels and their margins)
+    unsigned char * interp;
+    const SAMPLE ** window;
+    //window shape computed analytically (GRAIN_TABLE_ENVELOPE = use tables)
+    unsigned char * winShape;
+    //prebuilt envelope (NULL = read window table) and frames played from it
+    GrainEnvelope ** envelope;
+    unsigned long * envFrame;
+    //channel multipliers times grain gain, MY_CHANNELS entries per voice
+    SAMPLE * chanGains;
+
+    //per voice source lists (MAX_GRAIN_SOURCES slots per voice).  file data is
+    //copied in at trigger so rendering never goes back to theSounds.
+    //wave/frames/pos/inc refer to the octave copy the grain reads
+    unsigned int * numSources;
+    unsigned int * srcSound;
+    SAMPLE ** srcWave;
+    unsigned long * srcFrames;
+    unsigned int * srcChannels;
+    GrainPhase * srcPos;
+    GrainPhase * srcInc;
+    double * srcVol;
+    GrainSourceKernel * srcKernel;
+};
+
+
+#endif
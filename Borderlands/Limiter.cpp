@@ -0,0 +1,197 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  Limiter.cpp
+//  Borderlands
+//
+
+#include "Limiter.h"
+
+//frames the gain is held / averaged over
+#define LIMITER_WINDOW (LIMITER_LOOKAHEAD + 1)
+
+
+//-----------------------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------------------
+Limiter::~Limiter()
+{
+    grainFree(history);
+    grainFree(minGain);
+    grainFree(minFrame);
+    grainFree(avgRing);
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+Limiter::Limiter(double theCeilingDb, double theReleaseMs)
+{
+    history = (SAMPLE *) grainAlloc(sizeof(SAMPLE) * (LIMITER_LOOKAHEAD + GRAIN_BLOCK) * MY_CHANNELS);
+    minGain = (double *) grainAlloc(sizeof(double) * LIMITER_WINDOW);
+    minFrame = (unsigned long *) grainAlloc(sizeof(unsigned long) * LIMITER_WINDOW);
+    avgRing = (double *) grainAlloc(sizeof(double) * LIMITER_WINDOW);
+
+    //no reduction to start with
+    minHead = 0;
+    minCount = 0;
+    frameCount = 0;
+    env = 1.0;
+    for (int i = 0; i < LIMITER_WINDOW; i++)
+        avgRing[i] = 1.0;
+    avgPos = 0;
+    lowestGain = 1.0;
+
+    setCeilingDb(theCeilingDb);
+    setReleaseMs(theReleaseMs);
+}
+
+
+//-----------------------------------------------------------------------------
+// Settings
+//-----------------------------------------------------------------------------
+void Limiter::setCeilingDb(double theCeilingDb)
+{
+    if (theCeilingDb > 0.0)
+        theCeilingDb = 0.0;
+    ceilingDb = theCeilingDb;
+    ceiling = pow(10.0, ceilingDb * 0.05);
+}
+
+double Limiter::getCeilingDb()
+{
+    return ceilingDb;
+}
+
+void Limiter::setReleaseMs(double theReleaseMs)
+{
+    if (theReleaseMs < 1.0)
+        theReleaseMs = 1.0;
+    releaseMs = theReleaseMs;
+    //one pole rising ~63% of the way in releaseMs
+    releaseCoef = 1.0 - exp(-1.0 / (releaseMs * 0.001 * MY_SRATE));
+}
+
+double Limiter::getReleaseMs()
+{
+    return releaseMs;
+}
+
+double Limiter::getReductionDb()
+{
+    return 20.0 * log10(lowestGain);
+}
+
+
+//-----------------------------------------------------------------------------
+// Limit the output buffer (in runs of GRAIN_BLOCK frames)
+//-----------------------------------------------------------------------------
+void Limiter::process(SAMPLE * buff, unsigned int numFrames)
+{
+    lowestGain = 1.0;
+    for (unsigned int done = 0; done < numFrames; done += GRAIN_BLOCK){
+        int n = (numFrames - done < GRAIN_BLOCK) ? (int) (numFrames - done) : GRAIN_BLOCK;
+        processBlock(buff + done*MY_CHANNELS, n);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// One run: work out the gain for each incoming frame, then apply the gains
+// to the frames leaving the delay line
+//-----------------------------------------------------------------------------
+void Limiter::processBlock(SAMPLE * buff, int n)
+{
+    SAMPLE gains[GRAIN_BLOCK] GRAIN_ALIGN;
+    SAMPLE * incoming = history + LIMITER_LOOKAHEAD*MY_CHANNELS;
+    memcpy(incoming, buff, sizeof(SAMPLE) * n * MY_CHANNELS);
+
+    //running sum of the averaging window (re-summed each run so it never drifts)
+    double sum = 0.0;
+    for (int j = 0; j < LIMITER_WINDOW; j++)
+        sum += avgRing[j];
+
+    for (int i = 0; i < n; i++){
+        //gain this frame needs to stay under the ceiling
+        double peak = 0.0;
+        for (int k = 0; k < MY_CHANNELS; k++){
+            double a = fabs((double) incoming[i*MY_CHANNELS + k]);
+            if (a > peak)
+                peak = a;
+        }
+        double need = (peak > ceiling) ? ceiling / peak : 1.0;
+
+        //hold the smallest gain needed over the lookahead window
+        if ((minCount > 0) && (minFrame[minHead] + LIMITER_WINDOW <= frameCount)){
+            minHead = (minHead + 1) % LIMITER_WINDOW;
+            minCount--;
+        }
+        while ((minCount > 0) && (minGain[(minHead + minCount - 1) % LIMITER_WINDOW] >= need))
+            minCount--;
+        const unsigned int tail = (minHead + minCount) % LIMITER_WINDOW;
+        minGain[tail] = need;
+        minFrame[tail] = frameCount;
+        minCount++;
+        frameCount++;
+        const double hold = minGain[minHead];
+
+        //drop at once, recover over the release time
+        if (hold < env)
+            env = hold;
+        else
+            env += releaseCoef * (hold - env);
+
+        //average over the window - ramps down across the lookahead, and every
+        //term is at most the gain the delayed frame needs
+        sum += env - avgRing[avgPos];
+        avgRing[avgPos] = env;
+        avgPos = (avgPos + 1) % LIMITER_WINDOW;
+        double g = sum / (double) LIMITER_WINDOW;
+        if (g > 1.0)
+            g = 1.0;
+        gains[i] = (SAMPLE) g;
+        if (g < lowestGain)
+            lowestGain = g;
+    }
+
+    //apply to the delayed frames
+    int i = 0;
+#if defined(GRAIN_USE_SIMD) && (MY_CHANNELS == 2)
+    typedef GrainSimd<SAMPLE> S;
+    for (; i + S::W <= n; i += S::W){
+        S::V a, b;
+        S::V g = S::load(gains + i);
+        S::interleave(g, g, a, b);
+        S::store(buff + 2*i, S::mul(S::load(history + 2*i), a));
+        S::store(buff + 2*i + S::W, S::mul(S::load(history + 2*i + S::W), b));
+    }
+#endif
+    for (; i < n; i++){
+        for (int k = 0; k < MY_CHANNELS; k++)
+            buff[i*MY_CHANNELS + k] = history[i*MY_CHANNELS + k] * gains[i];
+    }
+
+    //keep the last LIMITER_LOOKAHEAD frames for the next run
+    memmove(history, history + n*MY_CHANNELS, sizeof(SAMPLE) * LIMITER_LOOKAHEAD * MY_CHANNELS);
+}
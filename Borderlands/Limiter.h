@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+//  Limiter.h
+//  Borderlands
+//
+//  Master output stage: a lookahead peak limiter run on the interleaved
+//  output buffer after every cloud has rendered.  The gain needed to keep
+//  each frame under the ceiling is held over the lookahead window, released
+//  slowly and then averaged over the window, so gain reduction starts
+//  before a peak arrives and output never exceeds the ceiling.  The output
+//  is delayed by LIMITER_LOOKAHEAD frames.
+//
+
+
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include "theglobals.h"
+#include "GrainKernels.h"
+
+//lookahead (frames)
+#define LIMITER_LOOKAHEAD 64
+
+//defaults
+#define LIMITER_CEILING_DB -0.3
+#define LIMITER_RELEASE_MS 80.0
+
+
+class Limiter
+{
+public:
+    //destructor
+    virtual ~Limiter();
+
+    //constructor
+    Limiter(double theCeilingDb = LIMITER_CEILING_DB, double theReleaseMs = LIMITER_RELEASE_MS);
+
+    //limit an interleaved buffer in place (MY_CHANNELS channels)
+    void process(SAMPLE * buff, unsigned int numFrames);
+
+    //ceiling (dB full scale, at most 0)
+    void setCeilingDb(double theCeilingDb);
+    double getCeilingDb();
+
+    //release time (ms)
+    void setReleaseMs(double theReleaseMs);
+    double getReleaseMs();
+
+    //largest gain reduction in the last buffer (dB, <= 0)
+    double getReductionDb();
+
+protected:
+    //limit one run of at most GRAIN_BLOCK frames
+    void processBlock(SAMPLE * buff, int n);
+
+private:
+    //settings
+    double ceilingDb, ceiling;
+    double releaseMs, releaseCoef;
+
+    //delay line: LIMITER_LOOKAHEAD frames of history followed by the current run
+    SAMPLE * history;
+
+    //sliding minimum of the required gain (monotonic queue, ring of LIMITER_LOOKAHEAD + 1)
+    double * minGain;
+    unsigned long * minFrame;
+    unsigned int minHead, minCount;
+    unsigned long frameCount;
+
+    //release envelope and its running average over the lookahead
+    double env;
+    double * avgRing;
+    unsigned int avgPos;
+
+    //metering
+    double lowestGain;
+};
+
+
+#endif
@@ -0,0 +1,180 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  RectGrid.cpp
+//  Borderlands
+//
+
+#include "RectGrid.h"
+#include <math.h>
+
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+RectGrid::RectGrid(float theWidth, float theHeight, unsigned int theCapacity)
+{
+    cols = (int) ceil(theWidth / RECT_GRID_CELL);
+    rows = (int) ceil(theHeight / RECT_GRID_CELL);
+    if (cols < 1)
+        cols = 1;
+    if (rows < 1)
+        rows = 1;
+    capacity = theCapacity;
+    maskWords = (capacity + RECT_MASK_BITS - 1) / RECT_MASK_BITS;
+    if (maskWords < 1)
+        maskWords = 1;
+    summaryWords = (maskWords + RECT_MASK_BITS - 1) / RECT_MASK_BITS;
+    cellWords = summaryWords + maskWords;
+
+    unsigned int numWords = cols * rows * cellWords;
+    cells = new std::atomic<unsigned long long>[numWords];
+    for (unsigned int i = 0; i < numWords; i++)
+        cells[i].store(0, std::memory_order_relaxed);
+
+    colLo = new int[capacity];
+    colHi = new int[capacity];
+    rowLo = new int[capacity];
+    rowHi = new int[capacity];
+    for (unsigned int i = 0; i < capacity; i++){
+        colLo[i] = colHi[i] = rowLo[i] = rowHi[i] = -1;
+    }
+}
+
+RectGrid::~RectGrid()
+{
+    delete [] cells;
+    delete [] colLo;
+    delete [] colHi;
+    delete [] rowLo;
+    delete [] rowHi;
+}
+
+
+//-----------------------------------------------------------------------------
+// Cell lookup
+//-----------------------------------------------------------------------------
+int RectGrid::colOf(float x)
+{
+    float c = floorf(x / RECT_GRID_CELL);
+    if (!(c > 0.0f))
+        return 0;
+    if (c >= (float) cols)
+        return cols - 1;
+    return (int) c;
+}
+
+int RectGrid::rowOf(float y)
+{
+    float r = floorf(y / RECT_GRID_CELL);
+    if (!(r > 0.0f))
+        return 0;
+    if (r >= (float) rows)
+        return rows - 1;
+    return (int) r;
+}
+
+unsigned int RectGrid::getCapacity()
+{
+    return capacity;
+}
+
+
+//-----------------------------------------------------------------------------
+// Place a rectangle.  it is added to its new cells before it leaves the old
+// ones, so a reader in between sees it in both (the exact test follows)
+// rather than in neither.  a word's summary bit is set after the word and
+// cleared after it empties, so a reader never misses a set word
+//-----------------------------------------------------------------------------
+void RectGrid::update(unsigned int idx, float left, float bot, float right, float top)
+{
+    if (idx >= capacity)
+        return;
+    int c0 = colOf(left), c1 = colOf(right);
+    int r0 = rowOf(bot), r1 = rowOf(top);
+    if ((c0 == colLo[idx]) && (c1 == colHi[idx]) && (r0 == rowLo[idx]) && (r1 == rowHi[idx]))
+        return;
+
+    unsigned int word = idx / RECT_MASK_BITS;
+    unsigned long long bit = 1ULL << (idx % RECT_MASK_BITS);
+    unsigned int usedWord = word / RECT_MASK_BITS;
+    unsigned long long usedBit = 1ULL << (word % RECT_MASK_BITS);
+
+    for (int r = r0; r <= r1; r++){
+        for (int c = c0; c <= c1; c++){
+            std::atomic<unsigned long long> * cell = cells + (r * cols + c) * cellWords;
+            cell[summaryWords + word].fetch_or(bit, std::memory_order_release);
+            cell[usedWord].fetch_or(usedBit, std::memory_order_release);
+        }
+    }
+    if (colLo[idx] >= 0){
+        for (int r = rowLo[idx]; r <= rowHi[idx]; r++){
+            for (int c = colLo[idx]; c <= colHi[idx]; c++){
+                if ((r >= r0) && (r <= r1) && (c >= c0) && (c <= c1))
+                    continue;
+                std::atomic<unsigned long long> * cell = cells + (r * cols + c) * cellWords;
+                if ((cell[summaryWords + word].fetch_and(~bit, std::memory_order_release) & ~bit) == 0)
+                    cell[usedWord].fetch_and(~usedBit, std::memory_order_release);
+            }
+        }
+    }
+
+    colLo[idx] = c0;
+    colHi[idx] = c1;
+    rowLo[idx] = r0;
+    rowHi[idx] = r1;
+}
+
+
+//-----------------------------------------------------------------------------
+// Rectangles in the cell under a point.  the walk keeps its own copy of the
+// current mask word, so nothing sized to the library lands on the caller
+//-----------------------------------------------------------------------------
+void RectGrid::first(float x, float y, RectGridWalk & theWalk)
+{
+    theWalk.summary = cells + (rowOf(y) * cols + colOf(x)) * cellWords;
+    theWalk.cell = theWalk.summary + summaryWords;
+    theWalk.usedWord = 0;
+    theWalk.used = theWalk.summary[0].load(std::memory_order_acquire);
+    theWalk.word = 0;
+    theWalk.bits = 0;
+}
+
+bool RectGrid::next(RectGridWalk & theWalk, unsigned int & theIdx)
+{
+    while (theWalk.bits == 0){
+        //only the words the summary marks as non-empty are read
+        while (theWalk.used == 0){
+            if (++theWalk.usedWord >= summaryWords)
+                return false;
+            theWalk.used = theWalk.summary[theWalk.usedWord].load(std::memory_order_acquire);
+        }
+        theWalk.word = theWalk.usedWord * RECT_MASK_BITS + (unsigned int) __builtin_ctzll(theWalk.used);
+        theWalk.used &= theWalk.used - 1;
+        theWalk.bits = theWalk.cell[theWalk.word].load(std::memory_order_acquire);
+    }
+    theIdx = theWalk.word * RECT_MASK_BITS + (unsigned int) __builtin_ctzll(theWalk.bits);
+    theWalk.bits &= theWalk.bits - 1;
+    return true;
+}
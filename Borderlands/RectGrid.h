@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.
+//------------------------------------------------------------------------------
+// More information is available at
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  RectGrid.h
+//  Borderlands
+//
+//  Uniform grid over the screen for finding the sound rectangles under a
+//  point.  Each cell keeps a bitmask of the rectangles that overlap it, so a
+//  grain or a mouse click only looks at the rectangles near it.  A summary
+//  mask per cell marks which 64-bit words of that bitmask are non-empty, so
+//  a lookup costs the rectangles in the cell, not the size of the library.
+//  Rectangles report their bounds whenever they move, resize or turn.
+//
+
+
+#ifndef RECTGRID_H
+#define RECTGRID_H
+
+#include "theglobals.h"
+#include <atomic>
+
+//cell size (pixels).  points off the screen fall in the edge cells
+#define RECT_GRID_CELL 64.0f
+
+#define RECT_MASK_BITS 64
+
+
+//position of a walk over one cell's rectangles (see RectGrid::first/next)
+struct RectGridWalk
+{
+    std::atomic<unsigned long long> * summary;
+    std::atomic<unsigned long long> * cell;
+    unsigned long long used;
+    unsigned long long bits;
+    unsigned int usedWord;
+    unsigned int word;
+};
+
+
+class RectGrid
+{
+public:
+    //destructor
+    virtual ~RectGrid();
+
+    //constructor (area covered, most rectangles it will hold)
+    RectGrid(float theWidth, float theHeight, unsigned int theCapacity);
+
+    //place rectangle idx over the given bounds (moves it if already placed)
+    void update(unsigned int idx, float left, float bot, float right, float top);
+
+    //walk the rectangles whose cell holds (x,y), lowest index first - only
+    //these can contain the point.  next() returns false when none are left
+    void first(float x, float y, RectGridWalk & theWalk);
+    bool next(RectGridWalk & theWalk, unsigned int & theIdx);
+
+    unsigned int getCapacity();
+
+protected:
+    //cell column/row of a coordinate (clamped to the grid)
+    int colOf(float x);
+    int rowOf(float y);
+
+private:
+    int cols, rows;
+    unsigned int capacity;
+    unsigned int maskWords;
+    unsigned int summaryWords;
+    unsigned int cellWords;
+
+    //per cell, summaryWords of non-empty word bits followed by maskWords of
+    //rectangle bits.  written by the ui thread only, read by the render
+    //threads
+    std::atomic<unsigned long long> * cells;
+
+    //cell range each rectangle covers (-1 = not placed)
+    int * colLo, * colHi, * rowLo, * rowHi;
+};
+
+
+#endif
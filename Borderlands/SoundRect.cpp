@@ -85,6 +85,10 @@ SoundRect::SoundRect(){
 //other intialization code
 void SoundRect::init(){
     
+    //not in a spatial index yet
+    grid = NULL;
+    gridIdx = 0;
+    
     //selection state
     isSelected = false;
     buffMult = (double) 1.0 / globalAtten;
@@ -158,6 +162,15 @@ void SoundRect::toggleOrientation(){
 }
 
 
+//register with a spatial index
+void SoundRect::setGrid(RectGrid * theGrid, unsigned int theIdx){
+    grid = theGrid;
+    gridIdx = theIdx;
+    if (grid)
+        grid->update(gridIdx,rleft,rbot,rright,rtop);
+}
+
+
 //color randomizer + alpha (roughly green/blue in color)
 void SoundRect::randColor()
 {
@@ -232,6 +245,8 @@ void SoundRect::updateCorners(float width, float height){
     rbot = rY - height * 0.5f;
     rright = rX + width * 0.5f;
     rleft = rX - width * 0.5f;
+    if (grid)
+        grid->update(gridIdx,rleft,rbot,rright,rtop);
     //    cout << "Sound Rect " << myId << ": "
     //    << rtop << ", " << rright << ", " <<
     //    rbot << ", " << rleft << endl;
@@ -310,7 +325,7 @@ void SoundRect::setUps(){
 //    lastY = (float)y;
 //}
 
-void SoundRect::associateSound(double * theBuff,unsigned long buffFrames,unsigned int buffChans){
+void SoundRect::associateSound(SAMPLE * theBuff,unsigned long buffFrames,unsigned int buffChans){
     
     myBuff = theBuff;
     myBuffFrames = buffFrames;
@@ -32,6 +32,7 @@
 #define SOUNDRECT_H
 
 #include "theglobals.h"
+#include "RectGrid.h"
 //#include "pt2d.h"
 //graphics includes
 #ifdef __MACOSX_CORE__
@@ -90,7 +91,7 @@ public:
     bool select(float x, float y);
 
     void toggleWaveDisplay();
-    void associateSound(double* theBuff,unsigned long buffFrames, unsigned int buffChans );
+    void associateSound(SAMPLE * theBuff,unsigned long buffFrames, unsigned int buffChans );
     //return id
     //unsigned int getId();
     
@@ -99,6 +100,8 @@ public:
 
     //change from vertical to horizontal
     void toggleOrientation();
+    //keep theGrid told where this rectangle is (as rectangle theIdx)
+    void setGrid(RectGrid * theGrid, unsigned int theIdx);
     //set name
     void setName(char * name);
     
@@ -122,7 +125,7 @@ private:
     bool isSelected;
     float colR,colG,colB,colA;
     float minDim;
-    double * myBuff;
+    SAMPLE * myBuff;
     double startTime;
     float ups;
     unsigned long myBuffFrames;
@@ -140,6 +143,9 @@ private:
     double buffMult;
     bool orientation;
     
+    //spatial index (NULL if not registered)
+    RectGrid * grid;
+    unsigned int gridIdx;
     
 };
 
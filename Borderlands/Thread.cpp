@@ -136,3 +136,18 @@ void Mutex :: unlock()
 
 #endif 
 }
+
+bool Mutex :: tryLock()
+{
+  bool result = false;
+#if (defined(__OS_IRIX__) || defined(__OS_LINUX__) || defined(__OS_MACOSX__)) || defined(__WINDOWS_PTHREAD__)
+
+  result = ( pthread_mutex_trylock(&mutex) == 0 );
+
+#elif defined(__OS_WINDOWS__)
+
+  result = ( TryEnterCriticalSection(&mutex) != 0 );
+
+#endif 
+  return result;
+}
@@ -86,6 +86,9 @@ class Mutex : public Stk
   //! Unlock the mutex.
   void unlock(void);
 
+  //! Lock the mutex if it is free.  Returns TRUE if the lock was taken (never blocks).
+  bool tryLock(void);
+
  protected:
 
   MUTEX mutex;
@@ -41,45 +41,46 @@
 
 using namespace std;
 
-enum {HANNING, TRIANGLE, EXPDEC, REXPDEC, SINC, RANDOM_WIN};
+enum {HANNING, TRIANGLE, EXPDEC, REXPDEC, SINC, GAUSSIAN, TUKEY, BLACKMAN_HARRIS, KAISER, RANDOM_WIN};
 
+//number of window shapes (RANDOM_WIN picks one of them)
+#define NUM_WINDOWS RANDOM_WIN
+
+//shape parameters (shared with the analytic envelopes in GrainOscEnv.h)
+#define GAUSSIAN_SIGMA 0.15
+#define TUKEY_ALPHA 0.5
+#define EXPDEC_TAU 512.0
+#define KAISER_BETA 8.6
+
+//samples before and after every window table (edge values repeated), so
+//interpolating readers need no bounds checks
+#define WINDOW_GUARD 8
+
+//window tables are built at compile time (see WindowBank.h), in both
+//sample formats, and never change
 class Window
 {
 public:
     static Window & Instance();
 
     
-    //return window
-    double * getWindow(unsigned int windowType);
-    //resize windows - future possibility, but probably not needed
-    //void resizeWindows(unsigned long length);
-
-    int numWindows();
-protected:
+    //return window (WINDOW_LEN frames, guarded, 64 byte aligned)
+    const SAMPLE * getWindow(unsigned int windowType);
 
-    //generate windows
-    void generateWindows(unsigned long length);
-    // window function prototypes
-    void hanning( double * window, unsigned long length );
-    //void trapezoid( double * window, unsigned long length );
-    void triangle( double * window, unsigned long length );
-    void expdec( double * forWin,double* revWin, unsigned long length );
-    void sinc( double * window, unsigned long length, int numZeroCross = 6);
+    //same tables in a given sample format
+    template <typename T>
+    const T * getTable(unsigned int windowType);
 
-    
+    int numWindows();
     
 private:
     ~Window();
-    Window(unsigned long length = 2048);
-    double * hanningWin;
-    //double * trapWin;
-    double * triWin;
-    double * expDecWin;
-    double * rexpDecWin;
-    double * sincWin;
- 
+    Window();
 };
 
+template <> const float * Window::getTable<float>(unsigned int windowType);
+template <> const double * Window::getTable<double>(unsigned int windowType);
+
 
 
-#endif
\ No newline at end of file
+#endif
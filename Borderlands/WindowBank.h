@@ -0,0 +1,227 @@
+//------------------------------------------------------------------------------
+// BORDERLANDS:  An interactive granular sampler.  
+//------------------------------------------------------------------------------
+// More information is available at 
+//     http::/ccrma.stanford.edu/~carlsonc/256a/Borderlands/index.html
+//
+//
+// Copyright (C) 2011  Christopher Carlson
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+//  WindowBank.h
+//  Borderlands
+//
+//  Window tables evaluated by the compiler.  The <cmath> functions are not
+//  constexpr, so the few needed here are written out as series.  A bank
+//  holds every shape for one sample type, each row padded with guard
+//  samples (the edge values repeated) so interpolators can read a few
+//  frames past either end, and each table starts on a 64 byte boundary.
+//  Only Window.cpp includes this.
+//
+
+
+#ifndef WINDOWBANK_H
+#define WINDOWBANK_H
+
+#include "Window.h"
+
+//4 term Blackman-Harris coefficients
+#define BLACKMAN_HARRIS_A0 0.35875
+#define BLACKMAN_HARRIS_A1 0.48829
+#define BLACKMAN_HARRIS_A2 0.14128
+#define BLACKMAN_HARRIS_A3 0.01168
+
+//table alignment (bytes)
+#define WINDOW_ALIGN 64
+
+
+//-----------------------------------------------------------------------------
+// constexpr math
+//-----------------------------------------------------------------------------
+constexpr double windowPi = 3.14159265358979323846;
+
+//e^x = 2^k e^r with |r| <= ln(2)/2
+constexpr double windowExp(double x)
+{
+    const double ln2 = 0.69314718055994530942;
+    long k = (long) (x / ln2 + ((x < 0.0) ? -0.5 : 0.5));
+    double r = x - k * ln2;
+    double sum = 1.0, term = 1.0;
+    for (int n = 1; n < 16; n++){
+        term *= r / n;
+        sum += term;
+    }
+    for (; k > 0; k--)
+        sum *= 2.0;
+    for (; k < 0; k++)
+        sum *= 0.5;
+    return sum;
+}
+
+//cos(x), reduced to [-pi, pi]
+constexpr double windowCos(double x)
+{
+    const double twoPi = 2.0 * windowPi;
+    long k = (long) (x / twoPi + ((x < 0.0) ? -0.5 : 0.5));
+    double r = x - k * twoPi;
+    double sum = 1.0, term = 1.0;
+    for (int n = 1; n < 16; n++){
+        term *= -r * r / ((2*n - 1) * (2*n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double windowSin(double x)
+{
+    return windowCos(x - 0.5 * windowPi);
+}
+
+constexpr double windowSqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    double g = (x > 1.0) ? x : 1.0;
+    for (int n = 0; n < 64; n++){
+        double next = 0.5 * (g + x / g);
+        if (next >= g)
+            break;
+        g = next;
+    }
+    return g;
+}
+
+//modified bessel function of the first kind, order 0
+constexpr double windowBesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; (k < 64) && (term > 1e-17 * sum); k++){
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+
+//-----------------------------------------------------------------------------
+// Value of frame i (0 .. length - 1) of a window shape - same curves the
+// runtime generators used to build
+//-----------------------------------------------------------------------------
+constexpr double windowShape(int type, long i, long length)
+{
+    const double len = (double) length;
+    const double x = (double) i / len;
+    switch (type) {
+        case TRIANGLE:{
+            double norm = 2.0 / (len - 1.0);
+            double invnorm = 1.0 / norm;
+            double d = (double) i - invnorm;
+            return norm * (invnorm - ((d < 0.0) ? -d : d));
+        }
+        case EXPDEC:
+            return windowExp(-(double) i / EXPDEC_TAU);
+        case REXPDEC:
+            return windowExp(-(len - 1.0 - (double) i) / EXPDEC_TAU);
+        case SINC:{
+            //8 zero crossings across the window, folded positive
+            double s = 8.0 * x - 4.0;
+            if (s == 0.0)
+                return 1.0;
+            double v = windowSin(windowPi * s) / (windowPi * s);
+            return (v < 0.0) ? -v : v;
+        }
+        case GAUSSIAN:{
+            double g = (x - 0.5) / GAUSSIAN_SIGMA;
+            return windowExp(-0.5 * g * g);
+        }
+        case TUKEY:
+            if (x < TUKEY_ALPHA * 0.5)
+                return 0.5 * (1.0 - windowCos(2.0 * windowPi * x / TUKEY_ALPHA));
+            if (x > 1.0 - TUKEY_ALPHA * 0.5)
+                return 0.5 * (1.0 - windowCos(2.0 * windowPi * (1.0 - x) / TUKEY_ALPHA));
+            return 1.0;
+        case BLACKMAN_HARRIS:
+            return BLACKMAN_HARRIS_A0
+                - BLACKMAN_HARRIS_A1 * windowCos(2.0 * windowPi * x)
+                + BLACKMAN_HARRIS_A2 * windowCos(4.0 * windowPi * x)
+                - BLACKMAN_HARRIS_A3 * windowCos(6.0 * windowPi * x);
+        case KAISER:{
+            double r = 2.0 * x - 1.0;
+            return windowBesselI0(KAISER_BETA * windowSqrt(1.0 - r * r)) / windowBesselI0(KAISER_BETA);
+        }
+        default:
+            //hanning / raised cosine
+            return 0.5 * (1.0 - windowCos(2.0 * windowPi * x));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Every shape for one sample type.  Rows are GUARD + WINDOW_LEN + GUARD
+// samples; GUARD is at least WINDOW_GUARD and a whole number of alignment
+// blocks, so each window starts aligned.
+//-----------------------------------------------------------------------------
+template <typename T>
+struct alignas(WINDOW_ALIGN) WindowBank
+{
+    enum {
+        GUARD = (WINDOW_ALIGN / sizeof(T) > WINDOW_GUARD) ? WINDOW_ALIGN / sizeof(T) : WINDOW_GUARD,
+        ROW = GUARD + WINDOW_LEN + GUARD
+    };
+
+    T data[NUM_WINDOWS][ROW];
+
+    constexpr WindowBank() : data()
+    {
+        for (int type = 0; type < NUM_WINDOWS; type++){
+            for (long i = 0; i < ROW; i++){
+                //guards repeat the edge frames
+                long frame = i - GUARD;
+                if (frame < 0)
+                    frame = 0;
+                if (frame > WINDOW_LEN - 1)
+                    frame = WINDOW_LEN - 1;
+                data[type][i] = (T) windowShape(type, frame, WINDOW_LEN);
+            }
+        }
+    }
+
+    //same values in another format
+    template <typename U>
+    constexpr WindowBank(const WindowBank<U> & other) : data()
+    {
+        for (int type = 0; type < NUM_WINDOWS; type++){
+            for (long i = 0; i < ROW; i++){
+                long frame = i - GUARD;
+                if (frame < 0)
+                    frame = 0;
+                if (frame > WINDOW_LEN - 1)
+                    frame = WINDOW_LEN - 1;
+                data[type][i] = (T) other.window(type)[frame];
+            }
+        }
+    }
+
+    //first frame of a window
+    constexpr const T * window(int type) const
+    {
+        return data[type] + GUARD;
+    }
+};
+
+
+#endif
@@ -36,17 +36,81 @@
 #include <GTime.h>
 
 
-//create sample datatype
+//create sample datatype (build with -DBORDERLANDS_FLOAT32 to store and mix
+//audio in single precision - twice the samples per vector, half the memory)
+#ifdef BORDERLANDS_FLOAT32
+#define SAMPLE float
+//create rtaudio format
+#define MY_FORMAT RTAUDIO_FLOAT32
+#else
 #define SAMPLE double
 //create rtaudio format
 #define MY_FORMAT RTAUDIO_FLOAT64
+#endif
 //set the sample rate
 #define MY_SRATE 44100
 //number of output channels
 #define MY_CHANNELS 2
 
+//frames rendered per engine block.  the audio callback is assembled from
+//blocks of this size, so grain timing and control updates do not depend on
+//the device buffer size
+#ifndef ENGINE_BLOCK
+#define ENGINE_BLOCK 64
+#endif
+
+//engine blocks a render thread keeps ready ahead of the audio callback
+//(0 = render inside the callback).  adds this much latency, but GUI or OS
+//hiccups no longer cause dropouts
+#ifndef RENDER_AHEAD_BLOCKS
+#define RENDER_AHEAD_BLOCKS 0
+#endif
+
+//shed work when rendering cannot keep up (see Governor.h)
+#ifndef LOAD_GOVERNOR
+#define LOAD_GOVERNOR 1
+#endif
+
+//clouds that can be bounced to new sound files per session (room for them
+//is reserved at startup)
+#ifndef MAX_BOUNCES
+#define MAX_BOUNCES 16
+#endif
+
+//deleted clouds waiting for the render thread to stop their grains before
+//they are freed
+#ifndef MAX_RETIRED_CLOUDS
+#define MAX_RETIRED_CLOUDS 16
+#endif
+
+//sounds one grain can play at once (the rectangles under it).  voices keep
+//this many source slots, however many files are loaded
+#ifndef MAX_GRAIN_SOURCES
+#define MAX_GRAIN_SOURCES 16
+#endif
+
+//grain voices in the shared pool (the polyphony cap for all clouds together)
+#ifndef MAX_POLYPHONY
+#define MAX_POLYPHONY 256
+#endif
+
 //window length
 #define WINDOW_LEN 2048
+
+//band limited octave copies built for each sound file (0 = off), so fast
+//grains read a decimated copy instead of striding through the original.
+//off by default - n copies cost 1/2 + 1/4 + ... of every file's memory
+//again (4 copies add about 94%)
+#ifndef MIPMAP_OCTAVES
+#define MIPMAP_OCTAVES 0
+#endif
+#define MAX_OCTAVES 8
+
+//compute Hann, Tukey, Gaussian and exponential grain envelopes as the grain
+//plays instead of reading window tables (0 = always use the tables)
+#ifndef GRAIN_ANALYTIC_ENVELOPES
+#define GRAIN_ANALYTIC_ENVELOPES 1
+#endif
 //graphics picking
 #define NAMEINCREMENT 100
 